@@ -18,6 +18,7 @@
 #include <string>
 #include <unistd.h>  // Provides sleep function for linux
 #include <ctime>
+#include <cmath>
 #include <vector>
 
 #include "robot.hpp"
@@ -26,7 +27,8 @@
 //#include "control_table_maps.hpp"
 
 
-#define BAUDRATE    1000000
+#define BAUDRATE    1000000     // Port opening baudrate, the bus one is set in the motors config file
+#define PORT_NAME   "/dev/ttyUSB0"
 #define NBR_MOTORS  5
 #define PI          3.14
 
@@ -45,6 +47,7 @@ vector<float> prev_goal_angles(NBR_MOTORS);
 // Functions
 double get_delta_us(struct timespec t2, struct timespec t1);
 timespec time_s();
+float turnAngle(float angle);
 
 int main()
 {
@@ -62,19 +65,20 @@ int main()
     int to_sleep = 0;
     int turnCnt = 1;
     bool stance = 0;
-    bool reset = 0;
     bool activate_motor1 = 0;
     bool activate_motor2 = 0;
     bool activate_motor3 = 0;
     bool activate_motor0 = 0;
 
     // Init start
-    KMR::dxlP1::Hal hal;
+    auto hal = std::make_shared<KMR::dxlP1::Hal>();
 
     char path_to_motor_config[] = "../config/test_motors_config.yaml";
-    char path_to_KMR_dxl[] = "../KMR_dxlP1";
 
-    vector<int> all_ids = hal.init(path_to_motor_config, path_to_KMR_dxl);
+    // Skip the config parsing and the motor pings if nothing changed since the last run
+    hal->enableWarmStart("motors_snapshot.bin", PORT_NAME, BAUDRATE);
+
+    vector<int> all_ids = hal->init(path_to_motor_config);
 
     cout << endl;
     cout << "List of motor IDs" << endl;
@@ -83,7 +87,7 @@ int main()
     cout << endl;
 
     // Create robot instance
-    Robot robot(all_ids, "/dev/ttyUSB0", BAUDRATE, hal);
+    Robot robot(all_ids, PORT_NAME, BAUDRATE, hal);
 
     // Start testing
     robot.enableMotors();
@@ -129,7 +133,7 @@ int main()
                 if (goal_angles[i] >= phase[3]) {
                     activate_motor3 = 1;
                 }
-                if (prev_goal_angles[i] >= 2*PI/3 && prev_goal_angles[i] <= PI && activate_motor0) {
+                if (turnAngle(prev_goal_angles[i]) >= 2*PI/3 && turnAngle(prev_goal_angles[i]) <= PI && activate_motor0) {
                         stance = 1;
                     }
                     if (cnt <= ticks_per_turn * duty_factor[i] && stance) {    // STANCE
@@ -153,7 +157,7 @@ int main()
                     stance = 0;
 
             } else if (i == 1 && activate_motor1) {
-                if (prev_goal_angles[i] >= 2*PI/3 && prev_goal_angles[i] <= PI) {
+                if (turnAngle(prev_goal_angles[i]) >= 2*PI/3 && turnAngle(prev_goal_angles[i]) <= PI) {
                     stance = 1;
                 }
                 if (cnt <= ticks_per_turn * duty_factor[i] && stance) {    // STANCE
@@ -177,7 +181,7 @@ int main()
                 stance = 0;
 
             } else if (i == 2 && activate_motor2) {
-                 if (prev_goal_angles[i] <= -2*PI/3 && prev_goal_angles[i] >= -PI) {
+                 if (turnAngle(prev_goal_angles[i]) <= -2*PI/3 && turnAngle(prev_goal_angles[i]) >= -PI) {
                     stance = 1;
                 }
                 if (cnt <= ticks_per_turn * duty_factor[i] && stance) {    // STANCE
@@ -201,7 +205,7 @@ int main()
                 stance = 0;
 
             } else if (i == 3 && activate_motor3) {
-                if (prev_goal_angles[i] <= -2*PI/3 && prev_goal_angles[i] >= -PI) {
+                if (turnAngle(prev_goal_angles[i]) <= -2*PI/3 && turnAngle(prev_goal_angles[i]) >= -PI) {
                     stance = 1;
                 }
                 if (cnt <= ticks_per_turn * duty_factor[i] && stance) {    // STANCE
@@ -226,31 +230,11 @@ int main()
             }
         }
 
-        for (int i=0; i<NBR_MOTORS; i++) {
-            if (goal_angles[i] > (2 * PI+0.02)) {
-                reset = 1;
-            } else if (goal_angles[i] < -(2*PI+0.02)) {
-                reset = 1;
-            }
-        }
-
-
          for (int i=0; i<NBR_MOTORS; i++) {
             cout << " before writing - goal_angles " << i << " : " << goal_angles[i] << "" << endl;
         }
 
-        robot.writeData(goal_angles, all_ids);
-
-
-        for (int i=0; i<NBR_MOTORS; i++) {
-            if (goal_angles[i] > (2 * PI+0.02) && reset) {
-                goal_angles[i] -= (2 * PI+0.02);
-                cout << " reset goal_angles " << i << " : " << goal_angles[i] << "" << endl;
-            } else if (goal_angles[i] < -(2 * PI+0.02) && reset) {
-                goal_angles[i] += (2 * PI+0.02);
-                cout << " reset goal_angles " << i << " : " << goal_angles[i] << "" << endl;
-            }
-        }
+        robot.writeReadData(goal_angles, fbck_angles);
 
 
         for (int i=0; i<NBR_MOTORS; i++) {
@@ -258,7 +242,6 @@ int main()
 
         }
 
-        reset = 0;
         /*
         if (cnt > ticks_per_turn+1){
             cout << "resetting count" << endl;
@@ -288,6 +271,17 @@ int main()
 
 }
 
+/**
+ * @brief       Angle of a leg within its current turn: the goal angles are continuous, 
+ *              they keep growing (or decreasing) from one turn to the next
+ * @param[in]   angle Continuous angle [rad]
+ * @retval      Angle within ]-2*PI, 2*PI[, same sign as the input
+ */
+float turnAngle(float angle)
+{
+    return fmod(angle, 2*PI);
+}
+
 timespec time_s()
 {
     struct timespec real_time;
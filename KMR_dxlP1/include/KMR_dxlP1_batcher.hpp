@@ -0,0 +1,61 @@
+/**
+ ******************************************************************************
+ * @file            KMR_dxlP1_batcher.hpp
+ * @brief           Header for the KMR_dxlP1_batcher.cpp file.
+ ******************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ ******************************************************************************
+ */
+
+#ifndef KMR_DXLP1_BATCHER_HPP
+#define KMR_DXLP1_BATCHER_HPP
+
+#include "KMR_dxlP1_writer.hpp"
+#include "KMR_dxlP1_reader.hpp"
+
+#define BATCH_MAX_WRITERS   32  // Writers queued between two port writes
+
+namespace KMR::dxlP1
+{
+
+/**
+ * @brief       Batcher of the bus transactions of a control cycle
+ * @details 	Sync writes get no reply from the motors: the frames of all writers of a cycle 
+ * 				can be sent back to back, followed by a bulk read request, with a single port write. 
+ * 				The replies to the read request are then parsed from one receive stream. \n
+ * 				On USB-serial converters, this saves a latency period per avoided transfer. \n
+ * 				Usage, at each cycle: addWrite(...) for each writer, optionally addRead(...), then flush().
+ */
+class Batcher
+{
+private:
+	dynamixel::PortHandler *portHandler_;
+	dynamixel::PacketHandler *packetHandler_;
+	uint8_t *m_tx_buffer;		// Frames of the current cycle, concatenated
+	int m_tx_length = 0;		// Number of bytes in m_tx_buffer
+	Reader *m_reader = nullptr;	// Reader whose request ends the cycle, if any
+	Writer *m_pending_writers[BATCH_MAX_WRITERS];	// Writers whose frames are in m_tx_buffer
+	int m_nbr_pending_writers = 0;	// Number of writers in m_pending_writers
+
+	void append(const uint8_t *frame, int size);
+	void sendPending();
+	void unmarkPendingWrites();
+
+public:
+	Batcher(dynamixel::PortHandler *portHandler, dynamixel::PacketHandler *packetHandler);
+	~Batcher();
+	Batcher(const Batcher&) = delete;
+	Batcher& operator=(const Batcher&) = delete;
+	void addWrite(Writer *writer);
+	void addRead(Reader *reader);
+	void flush();
+};
+
+}
+
+#endif
@@ -0,0 +1,194 @@
+/**
+ ******************************************************************************
+ * @file            KMR_dxlP1_field_traits.hpp
+ * @brief           Compile-time properties of the protocol 1 control fields
+ ******************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ ******************************************************************************
+ */
+
+#ifndef KMR_DXLP1_FIELD_TRAITS_HPP
+#define KMR_DXLP1_FIELD_TRAITS_HPP
+
+#include "KMR_dxlP1_hal.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+namespace KMR::dxlP1
+{
+
+/**
+ * @brief       Conversion applied by a handler between SI units and parametrized data
+ * @details		DIRECTION_CODEC is a scalar sent as sign-magnitude: the magnitude in the lower 
+ * 				bits, bit 10 set for the clockwise direction (eg. speeds in wheel mode, loads, goal torques)
+ */
+enum Codec_kinds
+{
+	SCALAR_CODEC, ANGLE_CODEC, DIRECTION_CODEC
+};
+
+inline constexpr int32_t DIRECTION_BIT = 1 << 10;			// Set for clockwise values
+inline constexpr int32_t DIRECTION_MAGNITUDE = DIRECTION_BIT - 1;	// Largest magnitude of a value
+
+/**
+ * @brief       Protocol-level properties of a data field, common to all motor models
+ */
+struct Field_info {
+	Fields field;
+	Codec_kinds codec;		// Conversion between SI units and parametrized data
+	int length;				// Byte size of the field
+	bool is_signed;			// Parametrized data is a two's complement value
+	bool is_integer;		// Data is a count/flag (int) rather than a physical quantity (float)
+};
+
+/**
+ * @brief       Properties of all data fields, indexed by Fields
+ */
+inline constexpr Field_info FIELD_INFOS[NBR_FIELDS] = {
+	// EEPROM
+	{MODEL_NBR,        SCALAR_CODEC,    2, false, true},
+	{FIRMWARE,         SCALAR_CODEC,    1, false, true},
+	{ID,               SCALAR_CODEC,    1, false, true},
+	{BAUDRATE,         SCALAR_CODEC,    1, false, true},
+	{RETURN_DELAY,     SCALAR_CODEC,    1, false, false},
+	{CW_ANGLE_LIMIT,   ANGLE_CODEC,     2, false, false},
+	{CCW_ANGLE_LIMIT,  ANGLE_CODEC,     2, false, false},
+	{TEMP_LIMIT,       SCALAR_CODEC,    1, false, false},
+	{MIN_VOLT_LIMIT,   SCALAR_CODEC,    1, false, false},
+	{MAX_VOLT_LIMIT,   SCALAR_CODEC,    1, false, false},
+	{MAX_TORQUE,       SCALAR_CODEC,    2, false, false},
+	{STATUS_RETURN,    SCALAR_CODEC,    1, false, true},
+	{ALARM_LED,        SCALAR_CODEC,    1, false, true},
+	{SHUTDOWN,         SCALAR_CODEC,    1, false, true},
+	{MULTITURN_OFFSET, SCALAR_CODEC,    2, true,  true},
+	{RES_DIVIDER,      SCALAR_CODEC,    1, false, true},
+	// RAM
+	{TRQ_ENABLE,       SCALAR_CODEC,    1, false, true},
+	{LED,              SCALAR_CODEC,    1, false, true},
+	{D_GAIN,           SCALAR_CODEC,    1, false, true},
+	{I_GAIN,           SCALAR_CODEC,    1, false, true},
+	{P_GAIN,           SCALAR_CODEC,    1, false, true},
+	{GOAL_POS,         ANGLE_CODEC,     2, true,  false},
+	{MOVING_SPEED,     DIRECTION_CODEC, 2, false, false},
+	{TORQUE_LIMIT,     SCALAR_CODEC,    2, false, false},
+	{PRESENT_POS,      ANGLE_CODEC,     2, true,  false},
+	{PRESENT_SPEED,    DIRECTION_CODEC, 2, false, false},
+	{PRESENT_LOAD,     DIRECTION_CODEC, 2, false, false},
+	{PRESENT_VOLT,     SCALAR_CODEC,    1, false, false},
+	{PRESENT_TEMP,     SCALAR_CODEC,    1, false, false},
+	{REGISTERED,       SCALAR_CODEC,    1, false, true},
+	{MOVING,           SCALAR_CODEC,    1, false, true},
+	{LOCK,             SCALAR_CODEC,    1, false, true},
+	{PUNCH,            SCALAR_CODEC,    2, false, true},
+	{REALTIME_TICK,    SCALAR_CODEC,    2, false, false},
+	{CURRENT,          SCALAR_CODEC,    2, false, false},
+	{TRQ_MODE_ENABLE,  SCALAR_CODEC,    1, false, true},
+	{GOAL_TORQUE,      DIRECTION_CODEC, 2, false, false},
+	{GOAL_ACC,         SCALAR_CODEC,    1, false, false},
+};
+
+/**
+ * @brief       Check that FIELD_INFOS is ordered as the Fields enumerate
+ */
+constexpr bool fieldInfosOrdered()
+{
+	for (int i=0; i<NBR_FIELDS; i++) {
+		if (FIELD_INFOS[i].field != i)
+			return false;
+	}
+	return true;
+}
+static_assert(fieldInfosOrdered(), "FIELD_INFOS must follow the order of the Fields enumerate");
+
+
+/**
+ * @brief       Compile-time properties of a data field
+ * @details		Used by the typed handlers FieldWriter and FieldReader to resolve the conversion,
+ * 				byte size and data type of their field at compile time
+ */
+template <Fields F>
+struct Field_traits {
+	static_assert(F >= 0 && F < NBR_FIELDS, "Not a valid data field");
+
+	static constexpr Codec_kinds codec = FIELD_INFOS[F].codec;
+	static constexpr int length = FIELD_INFOS[F].length;
+	static constexpr bool is_signed = FIELD_INFOS[F].is_signed;
+	using si_type = std::conditional_t<FIELD_INFOS[F].is_integer, int, float>;
+};
+
+
+/**
+ * @brief       Convert a signed parametrized value to its sign-magnitude form, saturated
+ * @param[in]   data Signed parametrized value, negative for clockwise
+ * @retval      Sign-magnitude value to be sent
+ */
+inline int32_t encodeDirection(int32_t data)
+{
+	if (data < 0)
+		return std::min(-data, DIRECTION_MAGNITUDE) | DIRECTION_BIT;
+	else
+		return std::min(data, DIRECTION_MAGNITUDE);
+}
+
+/**
+ * @brief       Convert a sign-magnitude value, as read from a motor, to a signed parametrized value
+ * @param[in]   data Sign-magnitude value
+ * @retval      Signed parametrized value, negative for clockwise
+ */
+inline int32_t decodeDirection(int32_t data)
+{
+	int32_t magnitude = data & DIRECTION_MAGNITUDE;
+	return (data & DIRECTION_BIT) ? -magnitude : magnitude;
+}
+
+/**
+ * @brief       Write a parametrized data into a handler's parameter bytes (little endian)
+ * @param[in]   data Parametrized data
+ * @param[out]  param Bytes to be sent to the motor
+ * @retval      void
+ */
+template <int L>
+inline void encodeParam(int32_t data, uint8_t* param)
+{
+	static_assert(L == 1 || L == 2 || L == 4, "Protocol 1 fields are 1, 2 or 4 bytes long");
+
+	uint32_t u_data = (uint32_t) data;
+
+	param[0] = (uint8_t) u_data;
+	if constexpr (L >= 2)
+		param[1] = (uint8_t) (u_data >> 8);
+	if constexpr (L == 4) {
+		param[2] = (uint8_t) (u_data >> 16);
+		param[3] = (uint8_t) (u_data >> 24);
+	}
+}
+
+/**
+ * @brief       Interpret raw read bytes of a field as a parametrized value
+ * @param[in]   raw Raw data as returned by the SDK
+ * @retval      Parametrized value, sign-extended for signed fields, signed for sign-magnitude fields
+ */
+template <Fields F>
+inline int32_t decodeParam(uint32_t raw)
+{
+	using traits = Field_traits<F>;
+
+	if constexpr (traits::codec == DIRECTION_CODEC)
+		return decodeDirection((int32_t) raw);
+	else if constexpr (traits::is_signed && traits::length == 1)
+		return (int8_t) raw;
+	else if constexpr (traits::is_signed && traits::length == 2)
+		return (int16_t) raw;
+	else
+		return (int32_t) raw;
+}
+
+}
+
+#endif
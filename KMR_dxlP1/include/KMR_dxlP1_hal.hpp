@@ -19,6 +19,10 @@
 #include <iostream>
 #include <cstdint>
 #include <vector>
+#include <memory>
+#include "KMR_dxlP1_motor_models.hpp"   // Generated at build time from config/motor_models
+
+#define NBR_IDS     256     // Size of the dense ID->index lookup tables
 
 namespace KMR::dxlP1
 {
@@ -52,16 +56,6 @@ struct Motor_node {
     int multiturn;
 };
 
-/**
- * @brief       Enumerate of all dynamixel motor models (not necessarily used in the project)
- * @attention   If a new model is added, this enum needs to be updated,
- *              as well as the function "string2Motors_models" in the .cpp
- */
-enum Motor_models
-{
-    MX_64R, NBR_MODELS, UNDEF_M
-};
-
 /**
  * @brief       Exhaustive list of all possible control modes for Dynamixel motors
  */
@@ -74,9 +68,32 @@ struct Control_modes {
     uint8_t PWM_control;
 };
 
+/**
+ * @brief       Position encoding of a motor model, used for conversions between angles and positions
+ */
+struct Position_codec {
+    int resolution;     // Number of positions per turn
+    int center;         // Position corresponding to the 0 rad angle
+    int min_position;   // Position range in joint mode
+    int max_position;
+    int multiturn_min;  // Position range in multiturn mode, empty if not supported
+    int multiturn_max;
+};
+
+/**
+ * @brief       Steps of a motor's multiturn reset, saved as its reset status
+ * @details     Each step after RESET_FLAGGED waits for its writes to be confirmed by a read
+ */
+enum Reset_steps
+{
+    RESET_IDLE, RESET_FLAGGED, RESET_TO_JOINT, RESET_JOINT_ENABLED, RESET_TO_MULTITURN, RESET_MULTITURN_ENABLED
+};
+
 /**
  * @brief   Structure saving the info of a single motor: both config-wise (ID, model...)
  *          and specific to the project (occupied indirect addresses, reset status...)
+ * @note    The Hal stores motors as structure-of-arrays: this structure is only an 
+ *          assembled copy, used while parsing and for one-off queries
  */
 struct Motor {
     int id;
@@ -112,12 +129,30 @@ enum Fields
  * @details     The lowest-level element in the library. The Hal class serves primarily as
  *              an abstraction layer, providing high-level functions to get the Dynamixel control
  *              table addresses by creating a control table. \n 
- *              It also parses the project's motors configuration file.
+ *              The control tables are compiled into the library from config/motor_models, 
+ *              but can be reloaded from the yaml files at runtime. \n 
+ *              It also parses the project's motors configuration file. \n 
+ *              A single Hal is shared (std::shared_ptr) by a robot and all its handlers: 
+ *              its configuration is immutable after init, and the only mutable state 
+ *              (reset statuses, scanned models) is changed through explicit setters.
  */
 class Hal {
 private:
     std::vector<std::string> m_unique_motor_models_list;   // List of unique motor models used in the robot
-
+    std::vector<Motor> m_parsed_motors;   // Motors read from the config file, before storage allocation
+    uint8_t* m_storage;     // Single allocation holding all the arrays below
+    size_t m_storage_size;
+
+    std::string m_snapshot_file;    // Warm-start snapshot, empty if warm start not enabled
+    std::string m_snapshot_port;    // Port and baudrate the snapshot is valid for
+    int m_snapshot_baudrate;
+    uint64_t m_snapshot_key;        // Hash of the snapshot's inputs
+    bool m_warm_started;            // True if the last init was loaded from the snapshot
+
+    void allocate_storage(int nbr_motors);
+    uint64_t snapshot_key(char* motor_config_file);
+    bool load_snapshot();
+    void load_compiled_control_table();
     void populate_control_table(char* path_to_KMR_dxl);
     void parse_motor_config(char* config_file);
     Motor_models string2Motors_models(const std::string& str);
@@ -125,24 +160,78 @@ private:
     void dataNode2Motor_data_field(Data_node& data_node, Motor_data_field& motor_data_field);
     void motorNode2Motor(Motor_node& motor_node, Motor& motor);
     void update_unique_models_list(std::string motor_model_string);
-    Motor_models getModelFromID(int id);
-    void saveControlValuesToMotors();
+    Motor_models getModelFromID(int id) const;
 
 public:
     int m_tot_nbr_motors;   // Number of motors used in the robot
-    Motor* m_motors_list;     // List containing all motors' info 
     std::vector<int> m_all_IDs;  // All motor IDs in the robot
-    Motor_data_field** m_control_table;   // Table containing all Dynamixel control values for every model
-    Control_modes* m_controlModesPerModel; // List of control modes values for each Dxl model
+
+    // Motors' info as structure-of-arrays, indexed by motors list index. Hot arrays first
+    int* m_motor_ids;                   // ID of each motor
+    int* m_reset_status;                // Multiturn reset step of each motor, as Reset_steps
+    int* m_multiturn;                   // 1 if the motor is used in multiturn mode
+    int* m_turn_offsets;                // Continuous - hardware multiturn position, in ticks (whole turns * resolution)
+    int* m_last_positions;              // Last read hardware multiturn position
+    uint8_t* m_position_tracked;        // 1 once a position of the motor was read
+    Motor_models* m_motor_models;       // Model of each motor
+    int16_t* m_idx_from_id;             // Motors list index of each ID (NBR_IDS entries), -1 if unused
+    int* m_scanned_models;              // Dynamixel-defined model numbers read from the motors
+    uint8_t* m_indir_address_offsets;   // Occupied indirect addresses (protocol 2 only)
+    uint8_t* m_indir_data_offsets;
+
+    Motor_data_field* m_control_table;      // Flat control table of every model: [model*NBR_FIELDS + field]
+    Control_modes* m_controlModesPerModel;  // List of control modes values for each Dxl model
+    Position_codec* m_positionCodecsPerModel;   // Position codec of each Dxl model
+
+    // Bus settings shared by the handlers
+    int m_status_return_level;  // Status return level of all motors, -1 if unknown
+    float m_max_return_delay;   // Largest return delay time of the motors (s), -1 if unknown
+    int m_bus_baudrate;         // Bus baudrate set in the config file, 0 to keep the motors' one
 
     Hal();
     ~Hal();
+    Hal(const Hal&) = delete;
+    Hal& operator=(const Hal&) = delete;
+    std::vector<int> init(char* motor_config_file);
     std::vector<int> init(char* motor_config_file, char* path_to_KMR_dxl);
     void get_ID_list_from_motors_list();
-    Motor_data_field getControlParametersFromID(int id, Fields field); 
-    int getMotorsListIndexFromID(int id);
-    Motor getMotorFromID(int id);
+    Motor_data_field getControlParametersFromID(int id, Fields field) const; 
+    int getMotorsListIndexFromID(int id) const;
+    Motor getMotorFromID(int id) const;
     void updateResetStatus(int id, int status);
+    void updateScannedModel(int id, int model_number);
+    void updateStatusReturn(int level, float max_return_delay);
+    void trackPosition(int motor_idx, int position);
+
+    void enableWarmStart(const char* snapshot_file, const char* port_name, int baudrate);
+    bool isWarmStarted() const;
+    void saveSnapshot();
+
+    /**
+     * @brief       Hot-path access to a model's control parameters for a field
+     */
+    const Motor_data_field& controlParameters(Motor_models model, Fields field) const 
+        { return m_control_table[model*(int)NBR_FIELDS + field]; }
+
+    /**
+     * @brief       Access to a model's position codec
+     */
+    const Position_codec& positionCodec(Motor_models model) const { return m_positionCodecsPerModel[model]; }
+
+    /**
+     * @brief       Hot-path read of a motor's "to reset" status, from its index in the motors list
+     */
+    int resetStatusAt(int motor_idx) const { return m_reset_status[motor_idx]; }
+
+    /**
+     * @brief       Hot-path update of a motor's "to reset" status, from its index in the motors list
+     */
+    void updateResetStatusAt(int motor_idx, int status) { m_reset_status[motor_idx] = status; }
+
+    /**
+     * @brief       Hot-path read of a multiturn motor's turn offset, from its index in the motors list
+     */
+    int turnOffsetAt(int motor_idx) const { return m_turn_offsets[motor_idx]; }
 };
 
 }
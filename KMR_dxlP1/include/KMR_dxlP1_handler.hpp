@@ -17,11 +17,57 @@
 
 #include "dynamixel_sdk/dynamixel_sdk.h"
 #include "KMR_dxlP1_hal.hpp"
+#include "KMR_dxlP1_field_traits.hpp"
+#include "KMR_dxlP1_kernels.hpp"
 #include <cstdint>
+#include <span>
+
+// Protocol 1 frame layout
+#define FRAME_HEADER0           0
+#define FRAME_HEADER1           1
+#define FRAME_ID                2
+#define FRAME_LENGTH            3
+#define FRAME_INSTRUCTION       4
+#define FRAME_ERROR             4   // Status packets: error byte instead of the instruction
+#define FRAME_PARAMETER0        5
+#define FRAME_MAX_LEN           250 // Same limit as the SDK's tx packets
+
+#define ALL_HANDLED_SERIAL      -1  // Registered set made of all handled motors, in handling order
 
 namespace KMR::dxlP1
 {
 
+class Handler;
+
+/**
+ * @brief       Set of motors checked once by a handler, to be reused at each control step
+ * @details		Created by Handler::prepareIDs. Reading/writing a prepared set skips the IDs' 
+ * 				validity check, and keeps the motors registered in the handler's SDK group 
+ * 				from one step to the next instead of rebuilding its parameters list
+ */
+struct Prepared_ids {
+	std::vector<int> ids;				// IDs of the set
+	const Handler *handler = nullptr;	// Handler the set was prepared for
+	int serial = 0;						// Number of the set within its handler
+	bool all_handled = false;			// The set contains all motors handled by the handler
+};
+
+/**
+ * @brief       Pre-resolved info of a single handled motor, built once at handler construction
+ * 				so that the reading/writing hot paths never search the Hal
+ */
+struct Motor_plan {
+	int hal_idx;			// Index of the motor in the Hal's motors list
+	float unit;				// Conversion unit between parametrized data and SI units
+	Codec_kinds codec;		// Conversion applied to the handled field
+	int multiturn;			// 1 if the motor is used in multiturn mode
+	bool unwrapped;			// Continuous multiturn position: hardware position + the motor's turn offset
+	int center;				// Position of the 0 rad angle
+	int min_position;		// Position range in joint mode
+	int max_position;
+	int reset_min;			// Multiturn positions beyond which the motor needs a reset
+	int reset_max;
+};
 
 /**
  * @brief       Parent class, to be specialized as a Reader or Writer
@@ -34,21 +80,34 @@ class Handler
 {
 public:
 	std::vector<int> m_ids;		// All IDs handled by this specific handler
-	Fields m_field;				// Field handled by this specific handler
+	Fields m_field;				// Field handled by this specific handler (first one if several)
+	std::vector<Fields> m_fields;	// All fields handled by this specific handler
+
+	Prepared_ids prepareIDs(std::span<const int> ids);
 
 
 protected:
 	dynamixel::PacketHandler *packetHandler_;
 	dynamixel::PortHandler *portHandler_;
-	Hal m_hal;
+	std::shared_ptr<Hal> m_hal;
 	uint8_t m_data_address = -1;		// Address where the data is written/read
 	uint8_t m_data_byte_size = 0;		// Total data byte size handled by the handler	
+	std::vector<Motor_plan> m_plan;		// Resolved info of each handled motor, same order as m_ids
+	int m_slot_from_id[NBR_IDS];		// Index in m_ids of each handled ID, -1 if not handled
+	int m_nbr_prepared = 0;				// Number of prepared sets created by this handler
+	int m_registered_serial = 0;		// Prepared set currently registered in the SDK group, 0 if none
 
+	uint8_t getFieldAddress(Fields field);
+	uint8_t getFieldLength(Fields field);
 	void checkMotorCompatibility(Fields field);
 	void getDataByteSize();
-	void checkIDvalidity(std::vector<int> ids);
+	void checkIDvalidity(std::span<const int> ids);
+	void checkPreparedIDs(const Prepared_ids& set);
 	void checkFieldValidity(Fields field);
+	void checkFieldLength(int length);
 	int getMotorIndexFromID(int id);
+	void buildPlan();
+	std::vector<Motor_plan> buildFieldPlan(Fields field);
 
 	// Methods that need to be implemented in child classes
 	virtual void clearParam() = 0; // Pure Virtual Function
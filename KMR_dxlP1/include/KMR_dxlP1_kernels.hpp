@@ -0,0 +1,110 @@
+/**
+ ******************************************************************************
+ * @file            KMR_dxlP1_kernels.hpp
+ * @brief           Batch conversions between parametrized data and SI units
+ ******************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ ******************************************************************************
+ * The handlers gather the values of all their motors into contiguous tables,
+ * then convert them in one pass. On x86 the conversions use SSE2 (4 motors
+ * per instruction), elsewhere a plain loop left to the compiler. Both give
+ * the same results.
+ ******************************************************************************
+ */
+
+#ifndef KMR_DXLP1_KERNELS_HPP
+#define KMR_DXLP1_KERNELS_HPP
+
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace KMR::dxlP1
+{
+
+/**
+ * @brief       Convert parametrized values to SI units: out = (param - center) * unit
+ * @param[in]   params Parametrized values, sign-extended
+ * @param[in]   centers Parametrized value of the SI zero of each value (0 for scalar fields)
+ * @param[in]   units Unit of each value
+ * @param[out]  out Values in SI units
+ * @param[in]   n Number of values
+ * @retval      void
+ */
+inline void decodeScaled(const int32_t* params, const int32_t* centers, const float* units, float* out, int n)
+{
+	int i = 0;
+
+#if defined(__SSE2__)
+	for (; i+4 <= n; i += 4) {
+		__m128i param = _mm_loadu_si128((const __m128i*) (params + i));
+		__m128i center = _mm_loadu_si128((const __m128i*) (centers + i));
+		__m128 unit = _mm_loadu_ps(units + i);
+		_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(param, center)), unit));
+	}
+#endif
+
+	for (; i<n; i++)
+		out[i] = (float) (params[i] - centers[i]) * units[i];
+}
+
+/**
+ * @brief       Sign-extend two's complement values narrower than 32 bits, in place
+ * @param[in/out]   params Values, read into the low bits
+ * @param[in]   bits Bit width of the values (8 or 16)
+ * @param[in]   n Number of values
+ * @retval      void
+ */
+inline void signExtend(int32_t* params, int bits, int n)
+{
+	int shift = 32 - bits;
+	int i = 0;
+
+#if defined(__SSE2__)
+	__m128i count = _mm_cvtsi32_si128(shift);
+	for (; i+4 <= n; i += 4) {
+		__m128i param = _mm_loadu_si128((const __m128i*) (params + i));
+		_mm_storeu_si128((__m128i*) (params + i), _mm_sra_epi32(_mm_sll_epi32(param, count), count));
+	}
+#endif
+
+	for (; i<n; i++)
+		params[i] = (int32_t) ((uint32_t) params[i] << shift) >> shift;
+}
+
+/**
+ * @brief       Convert SI values to their parametrized form: out = value / unit + bias, truncated
+ * @param[in]   values Values in SI units
+ * @param[in]   units Unit of each value
+ * @param[in]   biases Bias of each value (center + 0.5 to round angles, 0 for scalar fields)
+ * @param[out]  out Parametrized values
+ * @param[in]   n Number of values
+ * @retval      void
+ */
+inline void encodeScaled(const float* values, const float* units, const float* biases, int32_t* out, int n)
+{
+	int i = 0;
+
+#if defined(__SSE2__)
+	for (; i+4 <= n; i += 4) {
+		__m128 value = _mm_loadu_ps(values + i);
+		__m128 unit = _mm_loadu_ps(units + i);
+		__m128 bias = _mm_loadu_ps(biases + i);
+		_mm_storeu_si128((__m128i*) (out + i), _mm_cvttps_epi32(_mm_add_ps(_mm_div_ps(value, unit), bias)));
+	}
+#endif
+
+	for (; i<n; i++)
+		out[i] = (int32_t) (values[i] / units[i] + biases[i]);
+}
+
+}
+
+#endif
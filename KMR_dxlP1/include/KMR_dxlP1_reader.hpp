@@ -16,38 +16,225 @@
 #define KMR_DXLP1_READER_HPP
 
 #include "KMR_dxlP1_handler.hpp"
+#include <atomic>
+#include <chrono>
 
 namespace KMR::dxlP1
 {
 
 /**
- * @brief       Custom Reader class that contains a dynamixel::GroupSyncRead object
+ * @brief       Location and resolved info of a field handled by a Reader
+ */
+struct Read_field {
+	Fields field;
+	uint8_t address;				// Address of the field in the handled motors' control tables
+	uint8_t length;					// Byte size of the field
+	std::vector<Motor_plan> plan;	// Resolved info of each handled motor for this field
+	std::vector<float> units;		// Unit of each handled motor for this field
+	std::vector<int32_t> centers;	// Parametrized SI zero of each handled motor: center for angles, 0 otherwise
+	bool unwrapped;					// Multiturn positions of some motors, converted as continuous positions
+};
+
+/**
+ * @brief       Completed read published by a Reader, to be used by another thread
+ */
+struct Read_snapshot {
+	uint64_t seq = 0;								// Number of the read, 0 if no read was published yet
+	std::chrono::steady_clock::time_point stamp;	// Time at which the read request was sent
+	uint8_t *raw;									// Read span of each motor, [motor index * span byte size]
+	uint8_t *received;								// 1 if the motor replied to the read, [motor index]
+	std::chrono::steady_clock::time_point *sample_stamps;	// Request time of the motor's last valid reply, [motor index]
+	int32_t *turn_offsets;							// Turn offset of multiturn motors at the time of the read, [motor index]
+
+	// Filled on access by the Reader's snapshot accessors
+	int32_t *params;								// Parametrized values, [field index * nbr of motors + motor index]
+	float *data;									// Values in SI units, [field index * nbr of motors + motor index]
+	uint8_t *gathered;								// 1 if params holds a field's values, [field index]
+	uint8_t *decoded;								// 1 if data holds a field's values, [field index]
+};
+
+/**
+ * @brief       Custom Reader class, sending protocol 1 bulk read requests and parsing the motors' replies
  * @details 	This custom Reader class simplifies greatly the creation of dynamixel reading handlers. \n 
- * 				It takes care automatically of address assignment, even for indirect address handling. 
+ * 				It takes care automatically of address assignment, even for indirect address handling. \n
+ * 				A Reader can handle several fields: they are merged into the single address span 
+ * 				covering them all, so that they are fetched with one bulk read. \n
+ * 				The request frame and the reply buffers are allocated once, at construction. \n
+ * 				A read can also be split in two: beginRead sends the request and returns at once, 
+ * 				collect parses the replies later on, leaving the time in between for computations. \n
+ * 				Each completed read is also published as an immutable snapshot (triple buffer): 
+ * 				one consumer thread can get the latest one with latestSnapshot, without locks, 
+ * 				copies or blocking the thread using the bus. \n
+ * 				Only the first handled field is converted to SI units with each read: the other ones
+ * 				are converted when accessed (getFieldData), once per read. Their raw values 
+ * 				(ticks) are available too, with getFieldRawData. \n
+ * 				Motors that did not reply keep their last valid values: isValid and getSampleAge 
+ * 				tell which values come from the last read. The failed motors can be re-read 
+ * 				within a time budget, see setRetries.
  */
 class Reader : public Handler
 {
+friend class Batcher;
+
 protected:
-	dynamixel::GroupBulkRead *m_groupBulkReader;
+	std::vector<Read_field> m_read_fields;	// Handled fields, same order as m_fields
+
+	uint8_t *m_request;			// Bulk read request frame
+	int m_request_size = 0;		// Byte size of the current request, 0 if none
+	uint8_t *m_rx_buffer;		// Raw stream of the motors' replies
+	uint8_t *m_rawData;			// Read span of each handled motor, [motor index * m_data_byte_size]
+	uint8_t *m_received;		// 1 if a valid reply was received from a motor during the last read
+	int32_t *m_rawPerField;		// Parametrized values of each field, [field index * nbr motors + motor index]
+	uint64_t *m_gathered_seq;	// Read whose values are in m_rawPerField, [field index]
+	uint64_t *m_decoded_seq;	// Read whose values are in m_dataPerField, [field index]
+	std::chrono::steady_clock::time_point *m_sample_stamps;	// Request time of each motor's last valid reply
+	int32_t *m_turn_offsets;	// Turn offset of each multiturn motor, as of the last read
+	int m_tracked_field = -1;	// Index of PRESENT_POS in the handled fields, -1 if not handled
+	int *m_retry_ids;			// Motors to be read again
+	int m_max_retries = 0;		// Maximal number of re-reads of the failed motors
+	std::chrono::microseconds m_retry_budget{0};	// Time after the first request during which re-reads can start
+	int *m_pending_ids;			// Motors of a started read, waiting to be collected
+	int m_nbr_pending = -1;		// Number of motors of the started read, -1 if no read started
+	int m_pending_comm_result;	// Communication result of the started read's request
+
+	Read_snapshot m_snapshots[3];			// Triple buffer of the published reads
+	int m_snapshot_back = 0;				// Snapshot filled by the bus thread
+	std::atomic<int> m_snapshot_middle{1};	// Last published snapshot, flagged if not taken yet by the consumer
+	int m_snapshot_front = 2;				// Snapshot used by the consumer thread
+	uint64_t m_nbr_reads = 0;				// Number of published reads
+	std::chrono::steady_clock::time_point m_request_stamp;	// Time at which the last request was sent
 
 	void clearParam();
-	bool addParam(uint8_t id);
-	void checkReadSuccessful(std::vector<int> ids);
-	void populateOutputMatrix(std::vector<int> ids);
-	float position2Angle(int32_t position, int id, float units);
+	void buildRequest(std::span<const int> ids);
+	int sendRequest(std::span<const int> ids);
+	int receiveReplies(std::span<const int> ids);
+	int parseReplies(int rx_length);
+	int getReplyLength(std::span<const int> ids);
+	void setReplyTimeout(int length, std::span<const int> ids);
+	int collectReplies(std::span<const int> ids);
+	void discardReplies(std::span<const int> ids);
+	int retryFailedReads(std::span<const int> ids);
+	void completeRead(std::span<const int> ids);
+	void readRegistered(std::span<const int> ids);
+	void beginRegistered(std::span<const int> ids);
+	void checkReadSuccessful(std::span<const int> ids);
+	virtual void populateOutputMatrix();
+	uint32_t getRawData(const uint8_t *raw, int motor_idx, int address, int length);
+	int getFieldIndex(Fields field);
+	void gatherField(int field_idx, const uint8_t *raw, int32_t *params);
+	void decodeField(int field_idx, const int32_t *params, const int32_t *turn_offsets, float *data);
+	void trackPositions(std::span<const int> ids);
+	int32_t* getGatheredField(int field_idx);
+	void publishSnapshot(std::span<const int> ids);
 
 public:
-	float *m_dataFromMotor;  // Table holding the read values from motors
+	float *m_dataFromMotor;  // Table holding the read values from motors (first handled field)
+	float **m_dataPerField;  // Read values of each handled field, [field index][motor index], 
+							 // converted on access by getFieldData except for the first field
 	int *motorIndices_dataFromMotor; // used? @todo
 	int *fieldIndices_dataFromMotor; // used? @todo
 
 	Reader(Fields field, std::vector<int> ids,
 			dynamixel::PortHandler *portHandler,
-			dynamixel::PacketHandler *packetHandler, Hal hal);
+			dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal);
+	Reader(std::vector<Fields> list_fields, std::vector<int> ids,
+			dynamixel::PortHandler *portHandler,
+			dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal);
 	~Reader();
-	void syncRead(std::vector<int> ids);
+	Reader(const Reader&) = delete;
+	Reader& operator=(const Reader&) = delete;
+	void syncRead(std::span<const int> ids);
+	void syncRead(const Prepared_ids& set);
+	void beginRead();
+	void beginRead(std::span<const int> ids);
+	void beginRead(const Prepared_ids& set);
+	bool collect();
+	bool isReadPending();
+	float* getFieldData(Fields field);
+	const int32_t* getFieldRawData(Fields field);
+	int32_t getRawValue(Fields field, int id);
+	void setRetries(int max_retries, std::chrono::microseconds budget);
+	bool isValid(int id);
+	const uint8_t* getValidMask();
+	double getSampleAge(int id);
+	const Read_snapshot& latestSnapshot();
+	const float* getSnapshotFieldData(const Read_snapshot& snapshot, Fields field);
+	const int32_t* getSnapshotRawData(const Read_snapshot& snapshot, Fields field);
+};
+
+
+/**
+ * @brief       Get a little-endian value from the read span of a motor
+ * @param[in]   raw Read spans of all handled motors (m_rawData or a snapshot's)
+ * @param[in]   motor_idx Index of the motor in the list of handled motors
+ * @param[in]   address Control table address of the value
+ * @param[in]   length Byte size of the value
+ * @retval      Raw value
+ */
+inline uint32_t Reader::getRawData(const uint8_t *raw, int motor_idx, int address, int length)
+{
+	const uint8_t *bytes = raw + motor_idx*m_data_byte_size + (address - m_data_address);
+
+	if (length == 1)
+		return bytes[0];
+	else if (length == 2)
+		return DXL_MAKEWORD(bytes[0], bytes[1]);
+	else
+		return DXL_MAKEDWORD(DXL_MAKEWORD(bytes[0], bytes[1]), DXL_MAKEWORD(bytes[2], bytes[3]));
+}
+
+/**
+ * @brief       Reader whose field is fixed at compile time
+ * @details 	The conversion, byte size and signedness of the field are resolved from Field_traits,
+ * 				so that the read data is decoded without runtime dispatch. \n
+ * 				Example: FieldReader<PRESENT_POS> reader(ids, portHandler, packetHandler, hal);
+ */
+template <Fields F>
+class FieldReader : public Reader
+{
+protected:
+	void populateOutputMatrix() override;
+
+public:
+	using traits = Field_traits<F>;
+
+	FieldReader(std::vector<int> ids, dynamixel::PortHandler *portHandler,
+				dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal);
 };
 
+/**
+ * @brief       Constructor for a typed Reader handler
+ * @param[in]   ids Motors to be handled by the reader
+ * @param[in]   portHandler Object handling port communication
+ * @param[in]   packetHandler Object handling packets
+ * @param[in]   hal Previously initialized Hal object, shared by all handlers
+ */
+template <Fields F>
+FieldReader<F>::FieldReader(std::vector<int> ids, dynamixel::PortHandler *portHandler,
+							dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal)
+: Reader(F, ids, portHandler, packetHandler, hal)
+{
+	checkFieldLength(traits::length);
+}
+
+/**
+ * @brief       Save the read data into the output matrix, converted in one pass for all handled motors
+ * @note        Motors out of the read, or that did not reply, get their last valid values
+ * @retval      void
+ */
+template <Fields F>
+void FieldReader<F>::populateOutputMatrix()
+{
+	int nbr_motors = m_ids.size();
+
+	for (int idx=0; idx<nbr_motors; idx++)
+		m_rawPerField[idx] = decodeParam<F>(getRawData(m_rawData, idx, m_data_address, traits::length));
+
+	decodeField(0, m_rawPerField, m_turn_offsets, m_dataFromMotor);
+	m_gathered_seq[0] = m_nbr_reads;
+	m_decoded_seq[0] = m_nbr_reads;
+}
+
 } // namespace KMR::dxl
 
 #endif
\ No newline at end of file
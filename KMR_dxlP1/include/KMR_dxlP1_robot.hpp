@@ -17,6 +17,8 @@
 
 #include "KMR_dxlP1_writer.hpp"
 #include "KMR_dxlP1_reader.hpp"
+#include "KMR_dxlP1_batcher.hpp"
+#include "KMR_dxlP1_wheel_drive.hpp"
 
 namespace KMR::dxlP1
 {
@@ -24,7 +26,12 @@ namespace KMR::dxlP1
 /**
  * @brief   Class that defines a base robot, to be inherited by a robot class in the project
  * @details This class contains base necessities for handling a robot with dynamixel motors. \n 
- *          It provides functions to enable/disable motors, as well as to reset motors in multiturn. \n 
+ *          It provides functions to enable/disable motors, as well as to reset motors in multiturn, 
+ *          one step per control cycle, and to switch motors to/from wheel mode. \n 
+ *          The configuration writes (torque enable, angle limits) are only sent to the 
+ *          motors whose register would change, as last written by the robot: see invalidateConfigMirror. \n 
+ *          At startup, the motors are set to reply to reads only, without return delay, and migrated 
+ *          to the bus baudrate set in the configuration file, if any. \n 
  *          The user needs to create handlers they need (Writers and Readers) for their specific
  *          application, as well as their respective reading/writing functions
  */
@@ -33,32 +40,52 @@ class BaseRobot {
         dynamixel::PortHandler   *portHandler_;
         dynamixel::PacketHandler *packetHandler_;
 
-        Writer *m_motor_enabler;
-        Writer *m_CW_limit;
-        Writer *m_CCW_limit;
-        Writer *m_torque_control;
+        FieldWriter<TRQ_ENABLE> *m_motor_enabler;
+        FieldWriter<CW_ANGLE_LIMIT> *m_CW_limit;
+        FieldWriter<CCW_ANGLE_LIMIT> *m_CCW_limit;
+        FieldWriter<STATUS_RETURN> *m_status_return_writer;
+        FieldWriter<RETURN_DELAY> *m_return_delay_writer;
+        Reader *m_status_reader;         // Reads back the status return level and return delay time
+        Prepared_ids m_enabler_all_ids;  // All motors, prepared for m_motor_enabler
+        Batcher *m_batcher;  // Batches the transactions of a control cycle into a single port write
+        Reader *m_reset_reader;  // Reads back the registers written by the reset steps and mode switches, and the positions
+        int *m_reset_ids;        // Motors whose reset step is being confirmed
+        int *m_mode_ids;         // Motors being disabled and switched to joint/multiturn mode
+        float *m_mode_limits;    // CW angle limits selecting the mode of m_mode_ids
+        int *m_enable_ids;       // Motors being enabled in their new mode
 
         void init_comm(const char *port_name, int baudrate, float protocol_version);
         void check_comm();
-        void setMultiturnControl_singleMotor(int id);
-        void setPositionControl_singleMotor(int id);
-        void setTorqueControl_singleMotor(int id, int on_off);
+        bool check_comm_warm();
+        bool readModelNumbers(std::vector<int>& model_numbers);
+        void configureStatusReturn();
+        int getResetLimit(int motor_idx, bool joint_mode);
+        bool isResetStepDone(int motor_idx, bool joint_mode, int torque);
+        int getModeLimit(int motor_idx, bool wheel_mode, bool cw);
+        void switchMode(std::span<const int> ids, bool wheel_mode);
+        int locateMotors(int baudrate, std::vector<int>& motor_rates);
+        void writeBaudrate(const std::vector<int>& motor_rates, int bus_rate, int baudrate);
 
         
     public:
         int *scanned_motor_models;  // Dynamixel-defined model numbers of motors in the robot
-        Hal m_hal;  // to put private? @todo
+        std::shared_ptr<Hal> m_hal;  // to put private? @todo
         std::vector<int> m_all_IDs; // All motor IDs in the robot
 
-        BaseRobot(std::vector<int> all_ids, const char *port_name, int baudrate, Hal hal);
+        BaseRobot(std::vector<int> all_ids, const char *port_name, int baudrate, std::shared_ptr<Hal> hal);
         ~BaseRobot();
        
         void enableMotors();
-        void enableMotors(std::vector<int> ids);
+        void enableMotors(std::span<const int> ids);
         void disableMotors();
-        void disableMotors(std::vector<int> ids);
+        void disableMotors(std::span<const int> ids);
         void resetMultiturnMotors();
         void resetMultiturnMotors(int sleep_time_us);
+        bool isResettingMultiturn();
+        void setWheelMode(std::span<const int> ids);
+        void setPositionMode(std::span<const int> ids);
+        void invalidateConfigMirror();
+        bool migrateBaudrate(int baudrate);
 };
 
 }
@@ -0,0 +1,67 @@
+/**
+ ******************************************************************************
+ * @file            KMR_dxlP1_wheel_drive.hpp
+ * @brief           Header for the KMR_dxlP1_wheel_drive.cpp file.
+ ******************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ ******************************************************************************
+ */
+
+#ifndef KMR_DXLP1_WHEEL_DRIVE_HPP
+#define KMR_DXLP1_WHEEL_DRIVE_HPP
+
+#include "KMR_dxlP1_writer.hpp"
+#include "KMR_dxlP1_reader.hpp"
+#include "KMR_dxlP1_batcher.hpp"
+
+namespace KMR::dxlP1
+{
+
+/**
+ * @brief       Speed drive of continuously rotating joints (eg. whegs), as an alternative to
+ * 				streaming multiturn goal positions
+ * @details 	The motors are in wheel mode (see BaseRobot::setWheelMode): they never need a
+ * 				multiturn reset. At each control cycle, drive() sends the speed of the trajectory
+ * 				plus a correction of the phase error, with a single MOVING_SPEED sync write. \n
+ * 				The phase loop is closed on the present positions, read every few cycles only,
+ * 				in the same port write as the speeds (see Batcher). The read angles are continuous:
+ * 				the motors must be declared multiturn in the configuration file, and be read
+ * 				at least once per half turn. \n
+ * 				Usage: stop(), BaseRobot::setWheelMode, drive(...) at each cycle, then hold(),
+ * 				BaseRobot::setPositionMode to get back to position control.
+ */
+class WheelDrive
+{
+private:
+	std::vector<int> m_ids;		// Driven motors
+	FieldWriter<MOVING_SPEED> m_speed_writer;
+	FieldWriter<GOAL_POS> m_goal_writer;	// Sets the goal positions before leaving wheel mode
+	FieldReader<PRESENT_POS> m_position_reader;
+	Batcher m_batcher;			// Sends the speeds and the position read request with one port write
+	float m_gain = 0;			// Speed correction per phase error [1/s]
+	int m_feedback_period = 1;	// Number of cycles between two position reads
+	int m_nbr_cycles = 0;		// Cycles since the last position read
+	float *m_speeds;			// Speeds sent at the current cycle [rad/s]
+	float *m_corrections;		// Speed corrections of the last position read [rad/s]
+
+public:
+	WheelDrive(std::vector<int> ids, dynamixel::PortHandler *portHandler,
+				dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal);
+	~WheelDrive();
+	WheelDrive(const WheelDrive&) = delete;
+	WheelDrive& operator=(const WheelDrive&) = delete;
+	void setPhaseLoop(float gain, int feedback_period);
+	void drive(std::span<const float> angles, std::span<const float> speeds);
+	void stop();
+	void hold();
+	const float* getAngles();
+};
+
+}
+
+#endif
@@ -15,42 +15,148 @@
 #ifndef KMR_DXLP1_WRITER_HPP
 #define KMR_DXLP1_WRITER_HPP
 
+#include <algorithm>
 #include <cstdint>
 #include "KMR_dxlP1_handler.hpp"
 
 namespace KMR::dxlP1
 {
 
+/**
+ * @brief       Location and resolved info of a field handled by a Writer
+ */
+struct Write_field {
+	Fields field;
+	uint8_t offset;					// Position of the field in the bytes sent to each motor
+	uint8_t length;					// Byte size of the field
+	std::vector<Motor_plan> plan;	// Resolved info of each handled motor for this field
+	std::vector<float> units;		// Unit of each handled motor for this field
+	std::vector<float> biases;		// Encoding bias of each handled motor: center + 0.5 for angles, 0 otherwise
+};
+
 /**
  * @brief       Custom Writer class that contains a dynamixel::GroupSyncWrite object
  * @details 	This custom Writer class simplifies greatly the creation of dynamixel writing handlers. \n 
- * 				It takes care automatically of address assignment, even for indirect address handling. 
+ * 				It takes care automatically of address assignment, even for indirect address handling. \n
+ * 				A Writer can handle several fields: they are packed, per motor, into the single 
+ * 				address span covering them all, so that they are sent with one sync write. \n
+ * 				With delta suppression enabled, only the motors whose data changed since it was 
+ * 				last sent are written, and nothing is sent if no data changed. \n
+ * 				If the Writer handles all motors on the bus, data shared by all of them can be sent 
+ * 				with a single broadcast write instead of a sync write, see enableBroadcast.
  */
 class Writer : public Handler
 {
-private:
+friend class Batcher;
+
+protected:
     dynamixel::GroupSyncWrite *m_groupSyncWriter;
     uint8_t **m_dataParam; // Table containing all parametrized data to be sent next step
+    std::vector<Write_field> m_write_fields;    // Handled fields, same order as m_fields
+    std::vector<uint8_t> m_staged;  // 1 if a field received data for a motor, [field index * nbr motors + motor index]
+    bool m_all_staged = false;      // All fields of all motors received data at least once
+
+    uint8_t *m_frame = nullptr;     // Sync write frame to all handled motors, m_dataParam pointing to its payloads
+    int m_frame_size = 0;           // Byte size of the frame, 0 if too long for the SDK's port buffers
+    uint8_t m_frame_sum = 0;        // Sum of the frame's checksummed bytes, updated with each payload byte change
+
+    float *m_values;                // Gathered data being staged, in SI units
+    float *m_units;                 // Gathered units of the motors being staged
+    float *m_biases;                // Gathered encoding biases of the motors being staged
+    int32_t *m_params;              // Parametrized data being staged
 
-    int angle2Position(float angle, int id);
+    bool m_delta_enabled = false;   // Only motors whose data changed are sent
+    int m_deadband = 0;             // Change [raw ticks] below or equal to which a motor is not sent
+    int m_refresh_period = 0;       // Number of sync writes between two sends to all motors, 0 if never forced
+    int m_nbr_delta_writes = 0;     // Sync writes since the last forced send to all motors
+    int32_t *m_sent_params;         // Last parametrized data sent, [field index * nbr motors + motor index]
+    uint8_t *m_sent;                // 1 if data was sent to the motor since delta suppression was enabled
+    int *m_delta_ids;               // Motors selected to be sent
+    int *m_delta_slots;             // Indexes of the motors selected to be sent, until their frame is written
+    int m_nbr_delta_slots = 0;      // Number of motors in m_delta_slots
+    uint8_t *m_delta_frame;         // Sync write frame to the selected motors only
+    bool m_broadcast_enabled = false;   // The handled motors are all the motors on the bus
+    uint8_t *m_broadcast_frame;     // Write frame to all motors on the bus, when they all get the same data
+
+    int limitPosition(int position, const Motor_plan& plan);
     void bindParameter(int lower_bound, int upper_bound, int &param);
-    void populateDataParam(int32_t data, int motor_idx, int field_length);
+    void populateDataParam(int32_t data, int motor_idx, int field_offset, int field_length);
+    int getFieldIndex(Fields field);
+    void checkSpanGaps(int span_start, int span_end);
+    void checkStaged(int motor_idx);
+    void checkAllStaged();
+    void buildFrame();
+    void patchParam(uint8_t *param, const uint8_t *bytes, int length);
+    void closeFrame();
+    int prepareFrame(const uint8_t*& frame);
+    int sendFrame(const uint8_t *frame, int frame_size);
+    int32_t getStagedParam(int motor_idx, int field_idx);
+    int selectChanged(std::span<const int> ids, int *changed_ids);
+    void unmarkSent();
+    int buildDeltaFrame(std::span<const int> ids);
+    int buildBroadcastFrame(std::span<const int> ids);
+    void registerParams(std::span<const int> ids);
+    template <typename T>
+    void stageData(std::span<const T> data, int field_idx, std::span<const int> ids);
     void clearParam();
     bool addParam(uint8_t id, uint8_t* data);
-    bool multiturnOverLimit(int position);
+    bool multiturnOverLimit(int position, const Motor_plan& plan);
 
 
 public:
     Writer(Fields field, std::vector<int> ids, dynamixel::PortHandler *portHandler,
-            dynamixel::PacketHandler *packetHandler, Hal hal);
+            dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal);
+    Writer(std::vector<Fields> list_fields, std::vector<int> ids, dynamixel::PortHandler *portHandler,
+            dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal);
     ~Writer();
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+    template <typename T>
+    void addDataToWrite(const std::vector<T>& data, const std::vector<int>& ids);
+    template <typename T>
+    void addDataToWrite(const std::vector<T>& data, Fields field, const std::vector<int>& ids);
     template <typename T>
-    void addDataToWrite(std::vector<T> data, std::vector<int> ids);
-    void syncWrite(std::vector<int> ids);
+    void addDataToWrite(std::span<const T> data, Fields field, std::span<const int> ids);
+    template <typename T>
+    void addDataToWrite(std::span<const T> data, Fields field, const Prepared_ids& set);
+    void syncWrite();
+    void syncWrite(std::span<const int> ids);
+    void syncWrite(const Prepared_ids& set);
+    void setDeltaSuppression(int deadband, int refresh_period);
+    void disableDeltaSuppression();
+    void enableBroadcast();
 };
 
+/**
+ * @brief       Overwrite some bytes of a motor's payload, keeping the frame's checksum up to date
+ * @param[in]   param First payload byte to be overwritten
+ * @param[in]   bytes New values of the bytes
+ * @param[in]   length Number of bytes to be overwritten
+ * @retval      void
+ */
+inline void Writer::patchParam(uint8_t *param, const uint8_t *bytes, int length)
+{
+    for (int j=0; j<length; j++) {
+        m_frame_sum += (uint8_t) (bytes[j] - param[j]);
+        param[j] = bytes[j];
+    }
+}
+
 // Templates need to be defined in hpp
 
+/**
+ * @brief       Add data to the list to be sent later with syncWrite, for the first handled field
+ * @param[in]   data Data to be sent to motors (eg, new goal positions), in SI units. \n
+ *              NB: If only one value is input, it will be sent to all input motors
+ * @param[in]   ids List of motors that will receive the data
+ * @retval      void
+ */
+template <typename T>
+void Writer::addDataToWrite(const std::vector<T>& data, const std::vector<int>& ids)
+{
+    addDataToWrite(std::span<const T>(data), m_field, std::span<const int>(ids));
+}
+
 /**
  * @brief       Add data to the list to be sent later with syncWrite
  * @param[in]   data Data to be sent to motors (eg, new goal positions), in SI units. \n
@@ -60,39 +166,214 @@ public:
  * @retval      void
  */
 template <typename T>
-void Writer::addDataToWrite(std::vector<T> data, std::vector<int> ids)
+void Writer::addDataToWrite(const std::vector<T>& data, Fields field, const std::vector<int>& ids)
+{
+    addDataToWrite(std::span<const T>(data), field, std::span<const int>(ids));
+}
+
+/**
+ * @brief       Add data to the list to be sent later with syncWrite, without heap allocation
+ * @param[in]   data Data to be sent to motors (eg, new goal positions), in SI units. \n
+ *              NB: If only one value is input, it will be sent to all input motors
+ * @param[in]   field Control field to receive the data
+ * @param[in]   ids List of motors that will receive the data
+ * @retval      void
+ */
+template <typename T>
+void Writer::addDataToWrite(std::span<const T> data, Fields field, std::span<const int> ids)
 {
     checkIDvalidity(ids);
+    stageData(data, getFieldIndex(field), ids);
+}
 
-    T current_data;
+/**
+ * @brief       Add data to be sent later to a prepared set of motors, without heap allocation
+ * @param[in]   data Data to be sent to motors (eg, new goal positions), in SI units, 
+ *              same order as the set's IDs. \n
+ *              NB: If only one value is input, it will be sent to all motors of the set
+ * @param[in]   field Control field to receive the data
+ * @param[in]   set Motors that will receive the data, prepared with prepareIDs
+ * @retval      void
+ */
+template <typename T>
+void Writer::addDataToWrite(std::span<const T> data, Fields field, const Prepared_ids& set)
+{
+    checkPreparedIDs(set);
+    stageData(data, getFieldIndex(field), std::span<const int>(set.ids));
+}
+
+/**
+ * @brief       Convert data to its parametrized form and save it into the parametrized data matrix
+ * @param[in]   data Data to be sent to motors, in SI units
+ * @param[in]   field_idx Index of the field in the list of handled fields
+ * @param[in]   ids List of motors that will receive the data, already checked
+ * @retval      void
+ */
+template <typename T>
+void Writer::stageData(std::span<const T> data, int field_idx, std::span<const int> ids)
+{
+    const Write_field& write_field = m_write_fields[field_idx];
+    int nbr_motors = m_ids.size();
     int param_data;
-    float units;
-    int id;
     int motor_idx = 0;
 
-    for (int i = 0; i < ids.size(); i++)
+    // Gathered by batches of at most all handled motors (the ids may be repeated)
+    for (int start = 0; start < ids.size(); start += nbr_motors)
     {
-        id = ids[i];
-        units = m_hal.getControlParametersFromID(id, m_field).unit;
-        motor_idx = getMotorIndexFromID(id);
+        int count = std::min(nbr_motors, (int) ids.size() - start);
 
-        if (data.size() == 1)
-            current_data = data[0];
-        else
-            current_data = data[i];
+        for (int i = 0; i < count; i++) {
+            motor_idx = m_slot_from_id[ids[start+i]];
+            m_values[i] = (data.size() == 1) ? data[0] : data[start+i];
+            m_units[i] = write_field.units[motor_idx];
+            m_biases[i] = write_field.biases[motor_idx];
+        }
 
         // Transform data into its parametrized form and write it into the parametrized data matrix
-        if (m_field != GOAL_POS && m_field != PRESENT_POS &&
-            m_field != CW_ANGLE_LIMIT && m_field != CCW_ANGLE_LIMIT) {
-            param_data = current_data / units;
-        }
-        else
-            param_data = angle2Position(current_data, id);
+        encodeScaled(m_values, m_units, m_biases, m_params, count);
 
-        populateDataParam(param_data, motor_idx, m_data_byte_size);
+        for (int i = 0; i < count; i++) {
+            motor_idx = m_slot_from_id[ids[start+i]];
+            param_data = m_params[i];
+            if (write_field.plan[motor_idx].codec == ANGLE_CODEC)
+                param_data = limitPosition(param_data, write_field.plan[motor_idx]);
+            else if (write_field.plan[motor_idx].codec == DIRECTION_CODEC)
+                param_data = encodeDirection(param_data);
 
+            populateDataParam(param_data, motor_idx, write_field.offset, write_field.length);
+            m_staged[field_idx*nbr_motors + motor_idx] = 1;
+        }
     }
+}
+
+
+/**
+ * @brief       Writer whose field is fixed at compile time
+ * @details 	The conversion, byte size and data type of the field are resolved from Field_traits,
+ * 				so that addDataToWrite has no runtime dispatch. Sending data of the wrong type 
+ * 				(eg. float to a LED) is a compile error. \n
+ * 				Example: FieldWriter<GOAL_POS> writer(ids, portHandler, packetHandler, hal);
+ */
+template <Fields F>
+class FieldWriter : public Writer
+{
+public:
+    using traits = Field_traits<F>;
+    using si_type = typename traits::si_type;
+
+    FieldWriter(std::vector<int> ids, dynamixel::PortHandler *portHandler,
+                dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal);
+    template <typename T>
+    void addDataToWrite(const std::vector<T>& data, const std::vector<int>& ids);
+    void addDataToWrite(std::span<const si_type> data, std::span<const int> ids);
+    void addDataToWrite(std::span<const si_type> data, const Prepared_ids& set);
+
+private:
+    void stageData(std::span<const si_type> data, std::span<const int> ids);
+};
+
+/**
+ * @brief       Constructor for a typed Writer handler
+ * @param[in]   ids Motors to be handled by the writer
+ * @param[in]   portHandler Object handling port communication
+ * @param[in]   packetHandler Object handling packets
+ * @param[in]   hal Previously initialized Hal object, shared by all handlers
+ */
+template <Fields F>
+FieldWriter<F>::FieldWriter(std::vector<int> ids, dynamixel::PortHandler *portHandler,
+                            dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal)
+: Writer(F, ids, portHandler, packetHandler, hal)
+{
+    checkFieldLength(traits::length);
+}
+
+/**
+ * @brief       Add data to the list to be sent later with syncWrite
+ * @param[in]   data Data to be sent to motors, in SI units. Its type needs to match the field's. \n
+ *              NB: If only one value is input, it will be sent to all input motors
+ * @param[in]   ids List of motors that will receive the data
+ * @retval      void
+ */
+template <Fields F>
+template <typename T>
+void FieldWriter<F>::addDataToWrite(const std::vector<T>& data, const std::vector<int>& ids)
+{
+    static_assert(std::is_same_v<T, si_type>, 
+                  "Data type does not match the field: int for flags and counts, float for physical quantities");
+
+    addDataToWrite(std::span<const si_type>(data), std::span<const int>(ids));
+}
+
+/**
+ * @brief       Add data to the list to be sent later with syncWrite, without heap allocation
+ * @param[in]   data Data to be sent to motors, in SI units. \n
+ *              NB: If only one value is input, it will be sent to all input motors
+ * @param[in]   ids List of motors that will receive the data
+ * @retval      void
+ */
+template <Fields F>
+void FieldWriter<F>::addDataToWrite(std::span<const si_type> data, std::span<const int> ids)
+{
+    checkIDvalidity(ids);
+    stageData(data, ids);
+}
 
+/**
+ * @brief       Add data to be sent later to a prepared set of motors, without heap allocation
+ * @param[in]   data Data to be sent to motors, in SI units, same order as the set's IDs. \n
+ *              NB: If only one value is input, it will be sent to all motors of the set
+ * @param[in]   set Motors that will receive the data, prepared with prepareIDs
+ * @retval      void
+ */
+template <Fields F>
+void FieldWriter<F>::addDataToWrite(std::span<const si_type> data, const Prepared_ids& set)
+{
+    checkPreparedIDs(set);
+    stageData(data, std::span<const int>(set.ids));
+}
+
+/**
+ * @brief       Convert data to its parametrized form and save it into the parametrized data matrix
+ * @param[in]   data Data to be sent to motors, in SI units
+ * @param[in]   ids List of motors that will receive the data, already checked
+ * @retval      void
+ */
+template <Fields F>
+void FieldWriter<F>::stageData(std::span<const si_type> data, std::span<const int> ids)
+{
+    const Write_field& write_field = m_write_fields[0];
+    int nbr_motors = m_ids.size();
+    int param_data;
+    int motor_idx = 0;
+
+    // Gathered by batches of at most all handled motors (the ids may be repeated)
+    for (int start = 0; start < ids.size(); start += nbr_motors)
+    {
+        int count = std::min(nbr_motors, (int) ids.size() - start);
+
+        for (int i = 0; i < count; i++) {
+            motor_idx = m_slot_from_id[ids[start+i]];
+            m_values[i] = (data.size() == 1) ? data[0] : data[start+i];
+            m_units[i] = write_field.units[motor_idx];
+            m_biases[i] = write_field.biases[motor_idx];
+        }
+
+        encodeScaled(m_values, m_units, m_biases, m_params, count);
+
+        for (int i = 0; i < count; i++) {
+            motor_idx = m_slot_from_id[ids[start+i]];
+            param_data = m_params[i];
+            if constexpr (traits::codec == ANGLE_CODEC)
+                param_data = limitPosition(param_data, m_plan[motor_idx]);
+            else if constexpr (traits::codec == DIRECTION_CODEC)
+                param_data = encodeDirection(param_data);
+
+            uint8_t bytes[traits::length];
+            encodeParam<traits::length>(param_data, bytes);
+            patchParam(m_dataParam[motor_idx], bytes, traits::length);
+            m_staged[motor_idx] = 1;
+        }
+    }
 }
 
 }
@@ -0,0 +1,215 @@
+/**
+ ******************************************************************************
+ * @file            KMR_dxlP1_batcher.cpp
+ * @brief           Defines the Batcher class
+ ******************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT 
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ ******************************************************************************
+ */
+
+#include "KMR_dxlP1_batcher.hpp"
+#include <cstring>
+
+#define BATCH_MAX_LEN   4096    // Capacity of the cycle's tx buffer
+
+
+using std::cout;
+using std::endl;
+
+
+namespace KMR::dxlP1
+{
+
+/**
+ * @brief       Constructor for a Batcher
+ * @param[in]   portHandler Object handling port communication
+ * @param[in]   packetHandler Object handling packets
+ */
+Batcher::Batcher(dynamixel::PortHandler *portHandler, dynamixel::PacketHandler *packetHandler)
+{
+    portHandler_ = portHandler;
+    packetHandler_ = packetHandler;
+
+    m_tx_buffer = new uint8_t[BATCH_MAX_LEN];
+}
+
+/**
+ * @brief Destructor
+ */
+Batcher::~Batcher()
+{
+    delete[] m_tx_buffer;
+}
+
+
+/*
+ *****************************************************************************
+ *                             Cycle building
+ ****************************************************************************/
+
+/**
+ * @brief       Queue the sync write frame of a writer, sending its staged data to all its motors
+ * @note        The frame is copied when queued: data staged afterwards is sent in the next cycle. \n
+ *              At most BATCH_MAX_WRITERS frames are queued per cycle
+ * @param[in]   writer Writer whose data is to be sent
+ * @retval      void
+ */
+void Batcher::addWrite(Writer *writer)
+{
+    // Frame too long for the SDK limits: send it on its own, keeping the order of the cycle
+    if (writer->m_frame_size == 0) {
+        sendPending();
+        writer->syncWrite();
+        return;
+    }
+
+    const uint8_t *frame;
+    int frame_size = writer->prepareFrame(frame);
+    if (frame_size == 0)
+        return;
+
+    append(frame, frame_size);
+    if (m_nbr_pending_writers == BATCH_MAX_WRITERS) {
+        cout << "[KMR::dxlP1::Batcher] At most " << BATCH_MAX_WRITERS << " writes per cycle!" << endl;
+        exit(1);
+    }
+    m_pending_writers[m_nbr_pending_writers++] = writer;
+}
+
+/**
+ * @brief       Set the reader whose bulk read request ends the cycle, reading all its motors
+ * @note        Motors only reply to one request at a time: a cycle holds a single read
+ * @param[in]   reader Reader whose fields are to be read
+ * @retval      void
+ */
+void Batcher::addRead(Reader *reader)
+{
+    if (m_reader != nullptr) {
+        cout << "[KMR::dxlP1::Batcher] Only one read per cycle!" << endl;
+        exit(1);
+    }
+
+    m_reader = reader;
+}
+
+/**
+ * @brief       Append a frame to the cycle's tx buffer, sending the buffer first if full
+ * @param[in]   frame Frame to be appended
+ * @param[in]   size Byte size of the frame
+ * @retval      void
+ */
+void Batcher::append(const uint8_t *frame, int size)
+{
+    if (m_tx_length + size > BATCH_MAX_LEN)
+        sendPending();
+
+    memcpy(m_tx_buffer + m_tx_length, frame, size);
+    m_tx_length += size;
+}
+
+
+/*
+ *****************************************************************************
+ *                             Cycle sending
+ ****************************************************************************/
+
+/**
+ * @brief       Send the queued frames now, without waiting for the end of the cycle
+ * @retval      void
+ */
+void Batcher::sendPending()
+{
+    if (m_tx_length == 0)
+        return;
+
+    int dxl_comm_result = COMM_SUCCESS;
+
+    if (portHandler_->is_using_)
+        dxl_comm_result = COMM_PORT_BUSY;
+    else {
+        portHandler_->is_using_ = true;
+        portHandler_->clearPort();
+        if (portHandler_->writePort(m_tx_buffer, m_tx_length) != m_tx_length)
+            dxl_comm_result = COMM_TX_FAIL;
+        portHandler_->is_using_ = false;
+    }
+
+    if (dxl_comm_result != COMM_SUCCESS) {
+        cout << packetHandler_->getTxRxResult(dxl_comm_result) << endl;
+        unmarkPendingWrites();
+    }
+
+    m_tx_length = 0;
+    m_nbr_pending_writers = 0;
+}
+
+/**
+ * @brief       Send all frames of the cycle with a single port write, then receive and 
+ *              save the replies to the read request, if any
+ * @retval      void
+ */
+void Batcher::flush()
+{
+    int dxl_comm_result = COMM_SUCCESS;
+    Reader *reader = m_reader;
+    m_reader = nullptr;
+
+    if (reader == nullptr) {
+        sendPending();
+        return;
+    }
+
+    // The read request of all the reader's motors ends the cycle
+    std::span<const int> ids(reader->m_ids);
+    if (reader->m_registered_serial != ALL_HANDLED_SERIAL) {
+        reader->buildRequest(ids);
+        reader->m_registered_serial = ALL_HANDLED_SERIAL;
+    }
+    append(reader->m_request, reader->m_request_size);
+
+    if (portHandler_->is_using_)
+        dxl_comm_result = COMM_PORT_BUSY;
+    else {
+        portHandler_->is_using_ = true;
+        portHandler_->clearPort();
+        if (portHandler_->writePort(m_tx_buffer, m_tx_length) != m_tx_length)
+            dxl_comm_result = COMM_TX_FAIL;
+        reader->m_request_stamp = std::chrono::steady_clock::now();
+    }
+    
+    // The replies come after the whole batch was sent
+    if (dxl_comm_result == COMM_SUCCESS) {
+        reader->setReplyTimeout(m_tx_length + reader->getReplyLength(ids), ids);
+        dxl_comm_result = reader->collectReplies(ids);
+    }
+    else {
+        if (dxl_comm_result == COMM_TX_FAIL)
+            portHandler_->is_using_ = false;
+        reader->discardReplies(ids);
+        unmarkPendingWrites();
+    }
+
+    if (dxl_comm_result != COMM_SUCCESS)
+        cout << packetHandler_->getTxRxResult(dxl_comm_result) << endl;
+
+    m_tx_length = 0;
+    m_nbr_pending_writers = 0;
+}
+
+/**
+ * @brief       After a failed port write, have the writers of the queued frames send their motors 
+ *              again with their next frame, so that no write is lost with delta suppression
+ * @retval      void
+ */
+void Batcher::unmarkPendingWrites()
+{
+    for (int i=0; i<m_nbr_pending_writers; i++)
+        m_pending_writers[i]->unmarkSent();
+}
+
+}
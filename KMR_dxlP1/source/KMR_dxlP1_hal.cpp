@@ -13,9 +13,24 @@
  */
 
 #include "KMR_dxlP1_hal.hpp"
+#include "KMR_dxlP1_control_tables.hpp"     // Generated at build time from config/motor_models
 #include "yaml-cpp/yaml.h"
 #include <iostream>
+#include <cmath>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>      // open, for the warm-start snapshot
+#include <sys/mman.h>   // mmap
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SNAPSHOT_MAGIC      "KMRDXLP1"
+#define SNAPSHOT_VERSION    4
 
 using namespace std;
 
@@ -92,10 +107,46 @@ struct convert<KMR::dxlP1::Control_modes>
     }
 };
 
+/**
+ * @brief       Overload YAML::Node.as to be usable with our Position_codec structure: \n
+ *              Convert YAML::Node to Position_codec
+ * @param[in]   node YAML:Node read by the YAML parser
+ * @param[out]  position_codec Instance of Position_codec to contain the info gotten from node
+ * @retval      void
+ */
+template <>
+struct convert<KMR::dxlP1::Position_codec>
+{
+
+    static bool decode(const Node &node, KMR::dxlP1::Position_codec &position_codec)
+    {
+        position_codec.resolution = node["resolution"].as<int>();
+        position_codec.center = node["center"].as<int>();
+        position_codec.min_position = node["min_position"].as<int>();
+        position_codec.max_position = node["max_position"].as<int>();
+        position_codec.multiturn_min = node["multiturn_min"].as<int>();
+        position_codec.multiturn_max = node["multiturn_max"].as<int>();
+
+        return true;
+    }
+};
+
 }
 
 namespace KMR::dxlP1
 {
+
+/**
+ * @brief       Header of the warm-start snapshot file, followed by the Hal's storage block
+ */
+struct Snapshot_header {
+    char magic[8];
+    uint32_t version;
+    int32_t nbr_motors;
+    int32_t bus_baudrate;
+    uint64_t key;
+    uint64_t storage_size;
+};
     
 /**
  * @brief       Constructor for Hal
@@ -103,34 +154,77 @@ namespace KMR::dxlP1
 Hal::Hal()
 {
     m_tot_nbr_motors = -1;
-    m_control_table = new Motor_data_field *[NBR_MODELS];
-    for (int i = 0; i < NBR_MODELS; i++)
-        m_control_table[i] = new Motor_data_field[NBR_FIELDS];
-
-    m_controlModesPerModel = new Control_modes[NBR_MODELS];
+    m_storage = nullptr;
+    m_storage_size = 0;
+    m_snapshot_baudrate = 0;
+    m_snapshot_key = 0;
+    m_warm_started = false;
+    m_status_return_level = -1;
+    m_max_return_delay = -1;
+    m_bus_baudrate = 0;
+}
 
+/**
+ * @brief       Initialize the hal: parse motor config file and load the control tables 
+ *              compiled into the library. To call immediately after the constructor   
+ * @param[in]   motor_config_file Configuration file of the motors in the project
+ * @return      Vector of all motor IDs 
+ */
+vector<int> Hal::init(char *motor_config_file)
+{
+    return init(motor_config_file, nullptr);
 }
 
 /**
  * @brief       Initialize the hal: parse motor config file and create the control table. 
  *              To call immediately after the constructor   
  * @param[in]   motor_config_file Configuration file of the motors in the project
+ * @param[in]   path_to_KMR_dxl Path from the working directory (build) to this library's folder. \n 
+ *              If not null, the control tables are re-read from the motor models' yaml files 
+ *              instead of using the compiled ones
  * @return      Vector of all motor IDs 
  */
 vector<int> Hal::init(char *motor_config_file, char* path_to_KMR_dxl)
 {
+    // Warm start: load the whole storage from the snapshot, without parsing anything
+    m_warm_started = false;
+    if (!m_snapshot_file.empty() && path_to_KMR_dxl == nullptr) {
+        m_snapshot_key = snapshot_key(motor_config_file);
+        if (load_snapshot()) {
+            m_warm_started = true;
+            get_ID_list_from_motors_list();
+            return m_all_IDs;
+        }
+    }
+
     // Parse the motor config specific to the current project
     parse_motor_config(motor_config_file);
 
+    // Allocate the motors' arrays and the control table, then save the parsed motors
+    allocate_storage(m_tot_nbr_motors);
+    for (int i = 0; i < NBR_IDS; i++)
+        m_idx_from_id[i] = -1;
+    for (int i = 0; i < m_tot_nbr_motors; i++) {
+        if (m_parsed_motors[i].id < 0 || m_parsed_motors[i].id >= NBR_IDS) {
+            cout << "[KMR::dxl] Motor ID " << m_parsed_motors[i].id << " is out of range!" << endl;
+            exit(1);
+        }
+        m_motor_ids[i] = m_parsed_motors[i].id;
+        m_motor_models[i] = m_parsed_motors[i].model;
+        m_multiturn[i] = m_parsed_motors[i].multiturn;
+        m_idx_from_id[m_motor_ids[i]] = i;
+    }
+    m_parsed_motors.clear();
+
     // Create the control table for all models
-    populate_control_table(path_to_KMR_dxl);
+    if (path_to_KMR_dxl == nullptr)
+        load_compiled_control_table();
+    else
+        populate_control_table(path_to_KMR_dxl);
 
     // Extract the list of motor IDs
     get_ID_list_from_motors_list();
 
-    // Save operating modes values to motors
-    saveControlValuesToMotors();
-
     return m_all_IDs;
 }
 
@@ -141,6 +235,209 @@ vector<int> Hal::init(char *motor_config_file, char* path_to_KMR_dxl)
 Hal::~Hal()
 {
     // cout << "[KMR::dxl] The Hal object is being deleted" << endl;
+    free(m_storage);
+}
+
+
+/**
+ * @brief       Reserve a sub-array in the Hal's single storage allocation
+ * @param[in]   offset Current end of the storage layout, updated
+ * @param[in]   bytes Size of the sub-array
+ * @param[in]   alignment Alignment of the sub-array's elements
+ * @retval      Offset of the sub-array from the start of the storage
+ */
+static size_t reserve(size_t& offset, size_t bytes, size_t alignment)
+{
+    size_t start = (offset + alignment - 1) / alignment * alignment;
+    offset = start + bytes;
+    return start;
+}
+
+/**
+ * @brief       Allocate, in a single zeroed block, the motors' arrays and the flat control table
+ * @note        The hot per-cycle arrays come first so that they share as few cache lines as possible
+ * @param[in]   nbr_motors Number of motors in the robot
+ * @retval      void
+ */
+void Hal::allocate_storage(int nbr_motors)
+{
+    size_t offset = 0;
+    size_t ids_at = reserve(offset, nbr_motors * sizeof(int), alignof(int));
+    size_t reset_at = reserve(offset, nbr_motors * sizeof(int), alignof(int));
+    size_t multiturn_at = reserve(offset, nbr_motors * sizeof(int), alignof(int));
+    size_t turn_offsets_at = reserve(offset, nbr_motors * sizeof(int), alignof(int));
+    size_t last_positions_at = reserve(offset, nbr_motors * sizeof(int), alignof(int));
+    size_t tracked_at = reserve(offset, nbr_motors * sizeof(uint8_t), alignof(uint8_t));
+    size_t models_at = reserve(offset, nbr_motors * sizeof(Motor_models), alignof(Motor_models));
+    size_t idx_at = reserve(offset, NBR_IDS * sizeof(int16_t), alignof(int16_t));
+    size_t table_at = reserve(offset, (size_t)NBR_MODELS * NBR_FIELDS * sizeof(Motor_data_field), alignof(Motor_data_field));
+    size_t modes_at = reserve(offset, NBR_MODELS * sizeof(Control_modes), alignof(Control_modes));
+    size_t codecs_at = reserve(offset, NBR_MODELS * sizeof(Position_codec), alignof(Position_codec));
+    size_t scanned_at = reserve(offset, nbr_motors * sizeof(int), alignof(int));
+    size_t indir_addr_at = reserve(offset, nbr_motors * sizeof(uint8_t), alignof(uint8_t));
+    size_t indir_data_at = reserve(offset, nbr_motors * sizeof(uint8_t), alignof(uint8_t));
+
+    free(m_storage);
+    m_storage_size = offset;
+    m_storage = (uint8_t *)calloc(1, m_storage_size);
+
+    m_motor_ids = (int *)(m_storage + ids_at);
+    m_reset_status = (int *)(m_storage + reset_at);
+    m_multiturn = (int *)(m_storage + multiturn_at);
+    m_turn_offsets = (int *)(m_storage + turn_offsets_at);
+    m_last_positions = (int *)(m_storage + last_positions_at);
+    m_position_tracked = m_storage + tracked_at;
+    m_motor_models = (Motor_models *)(m_storage + models_at);
+    m_idx_from_id = (int16_t *)(m_storage + idx_at);
+    m_control_table = (Motor_data_field *)(m_storage + table_at);
+    m_controlModesPerModel = (Control_modes *)(m_storage + modes_at);
+    m_positionCodecsPerModel = (Position_codec *)(m_storage + codecs_at);
+    m_scanned_models = (int *)(m_storage + scanned_at);
+    m_indir_address_offsets = m_storage + indir_addr_at;
+    m_indir_data_offsets = m_storage + indir_data_at;
+}
+
+
+/*****************************************************************************
+ *                         Warm-start snapshot
+ ****************************************************************************/
+
+/**
+ * @brief       Enable the warm start: Hal::init will load the motors and control tables from a 
+ *              snapshot file instead of parsing, as long as its inputs did not change. \n 
+ *              To call before Hal::init. Only used with the compiled control tables
+ * @param[in]   snapshot_file Binary snapshot file, created by saveSnapshot if not existing
+ * @param[in]   port_name Name of the port the robot is connected to
+ * @param[in]   baudrate Baudrate of the port
+ * @retval      void
+ */
+void Hal::enableWarmStart(const char* snapshot_file, const char* port_name, int baudrate)
+{
+    m_snapshot_file = snapshot_file;
+    m_snapshot_port = port_name;
+    m_snapshot_baudrate = baudrate;
+}
+
+/**
+ * @brief       Check if the last init was loaded from the warm-start snapshot
+ * @retval      bool: true if warm started. The scanned models then come from the snapshot 
+ *              and still need to be confirmed on the bus
+ */
+bool Hal::isWarmStarted() const
+{
+    return m_warm_started;
+}
+
+/**
+ * @brief       Compute the key of the snapshot: hash (FNV-1a) of the motors config file's content, 
+ *              the compiled control tables, the port and the baudrate
+ * @param[in]   motor_config_file Configuration file of the motors in the project
+ * @retval      Key of the snapshot
+ */
+uint64_t Hal::snapshot_key(char* motor_config_file)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash](const void* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash ^= ((const uint8_t*) data)[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    ifstream config(motor_config_file, ios::binary);
+    stringstream content;
+    content << config.rdbuf();
+    string config_string = content.str();
+
+    int version = SNAPSHOT_VERSION;
+    add(&version, sizeof(version));
+    add(config_string.data(), config_string.size());
+    add(&CONTROL_TABLES, sizeof(CONTROL_TABLES));
+    add(CONTROL_MODES, sizeof(CONTROL_MODES));
+    add(POSITION_CODECS, sizeof(POSITION_CODECS));
+    add(m_snapshot_port.data(), m_snapshot_port.size());
+    add(&m_snapshot_baudrate, sizeof(m_snapshot_baudrate));
+
+    return hash;
+}
+
+/**
+ * @brief       Memory-map the snapshot file and copy its storage block if it matches the current inputs
+ * @retval      bool: true if the snapshot was valid and loaded
+ */
+bool Hal::load_snapshot()
+{
+    struct stat file_stat;
+    int fd = open(m_snapshot_file.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size < (off_t) sizeof(Snapshot_header)) {
+        close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    const Snapshot_header* header = (const Snapshot_header*) mapping;
+    bool valid = memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) == 0 &&
+                 header->version == SNAPSHOT_VERSION && header->key == m_snapshot_key &&
+                 header->nbr_motors > 0 &&
+                 sizeof(Snapshot_header) + header->storage_size == (uint64_t) file_stat.st_size;
+
+    if (valid) {
+        allocate_storage(header->nbr_motors);
+        valid = (m_storage_size == header->storage_size);
+    }
+
+    if (valid) {
+        memcpy(m_storage, (const uint8_t*) mapping + sizeof(Snapshot_header), m_storage_size);
+        m_tot_nbr_motors = header->nbr_motors;
+        m_bus_baudrate = header->bus_baudrate;
+        for (int i = 0; i < m_tot_nbr_motors; i++) {
+            m_reset_status[i] = 0;
+            m_turn_offsets[i] = 0;
+            m_position_tracked[i] = 0;
+        }
+        cout << "[KMR::dxl] Warm start from snapshot: " << m_snapshot_file << endl;
+    }
+
+    munmap(mapping, file_stat.st_size);
+    return valid;
+}
+
+/**
+ * @brief       Save the motors' info, control tables and scanned models to the warm-start snapshot. \n 
+ *              Called by BaseRobot once the motors' communication is checked
+ * @retval      void
+ */
+void Hal::saveSnapshot()
+{
+    if (m_snapshot_file.empty() || m_snapshot_key == 0 || m_storage == nullptr)
+        return;
+
+    Snapshot_header header = {};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.nbr_motors = m_tot_nbr_motors;
+    header.bus_baudrate = m_bus_baudrate;
+    header.key = m_snapshot_key;
+    header.storage_size = m_storage_size;
+
+    // Write to a temporary file first, so that an interrupted save never leaves a corrupted snapshot
+    string tmp_file = m_snapshot_file + ".tmp";
+    ofstream out(tmp_file, ios::binary | ios::trunc);
+    out.write((const char*) &header, sizeof(header));
+    out.write((const char*) m_storage, m_storage_size);
+    out.close();
+
+    if (!out || rename(tmp_file.c_str(), m_snapshot_file.c_str()) != 0) {
+        cout << "[KMR::dxl] Could not save the warm-start snapshot " << m_snapshot_file << endl;
+        return;
+    }
 }
 
 
@@ -149,7 +446,25 @@ Hal::~Hal()
  ****************************************************************************/
 
 /**
- * @brief       Populate the control table's data fields for all motor models in the project
+ * @brief       Populate the control table and control modes of all models from the tables 
+ *              generated at build time: no file is opened nor parsed
+ * @retval      void
+ */
+void Hal::load_compiled_control_table()
+{
+    for (int model = 0; model < NBR_MODELS; model++)
+    {
+        for (int field = 0; field < NBR_FIELDS; field++)
+            m_control_table[model*(int)NBR_FIELDS + field] = CONTROL_TABLES[model][field];
+
+        m_controlModesPerModel[model] = CONTROL_MODES[model];
+        m_positionCodecsPerModel[model] = POSITION_CODECS[model];
+    }
+}
+
+/**
+ * @brief       Populate the control table's data fields for all motor models in the project, 
+ *              by parsing their yaml files at runtime. Overrides the compiled control tables
  * @param[in]   path_to_KMR_dxl Path from the working directory (build) to this library's folder
  * @retval      void
  */
@@ -172,11 +487,18 @@ void Hal::populate_control_table(char* path_to_KMR_dxl)
         // Read and convert the first line to get the motor model name
         string motor_model_string = config["model_name"].as<string>();
         Motor_models motor_model = string2Motors_models(motor_model_string);
+        if (motor_model == UNDEF_M) {
+            cout << "[KMR::dxl] Model " << motor_model_string << " is not compiled into the library, rebuild it!" << endl;
+            exit(1);
+        }
 
         // Read the values to set control modes
         Control_modes control_modes = config["operating_modes"][0].as<Control_modes>();
         m_controlModesPerModel[motor_model] = control_modes;
 
+        // Read the model's position encoding
+        m_positionCodecsPerModel[motor_model] = config["position_codec"][0].as<Position_codec>();
+
         // Read the motor_data nodes: get the name, address, length and unit of each data field
         for (int j = 0; j < config["motor_data"].size(); j++)
         {
@@ -184,10 +506,14 @@ void Hal::populate_control_table(char* path_to_KMR_dxl)
 
             // Convert the read node into our structures
             col = string2Fields(data_node.field_name);
+            if (col == UNDEF_F) {
+                cout << "[KMR::dxl] Unknown field " << data_node.field_name << " in " << config_file << endl;
+                exit(1);
+            }
             dataNode2Motor_data_field(data_node, motor_data_field);
 
             // Populate the control table
-            m_control_table[motor_model][col] = motor_data_field;
+            m_control_table[motor_model*(int)NBR_FIELDS + col] = motor_data_field;
         }
     }
 
@@ -199,22 +525,18 @@ void Hal::populate_control_table(char* path_to_KMR_dxl)
 
 /**
  * @brief       Convert a string to Motors_models enumerate
- * @attention   This function needs to be updated if new motor model added, as well as the enum
+ * @note        The model names are generated at build time from config/motor_models
  * @param[in]   str String to be converted into the enumerate value
  * @retval      Motors_models enumerate value
  */
 Motor_models Hal::string2Motors_models(const string &str)
 {
-    if (str == "MX_64R")
-        return MX_64R;
-    else
-        return UNDEF_M;
-    /* else if(str == "TUESDAY") return TUESDAY;
-    else if(str == "WEDNESDAY") return WEDNESDAY;
-    else if(str == "THURSDAY") return THURSDAY;
-    else if(str == "FRIDAY") return FRIDAY;
-    else if(str == "SATURDAY") return SATURDAY;
-    else return SUNDAY; */
+    for (int i = 0; i < NBR_MODELS; i++) {
+        if (str == MOTOR_MODEL_NAMES[i])
+            return (Motor_models) i;
+    }
+
+    return UNDEF_M;
 }
 
 /**
@@ -358,8 +680,12 @@ void Hal::parse_motor_config(char *config_file)
         exit(1);
     }
 
-    // Create the list of motors (NB: had to use malloc because the struct. does not have a constructor)
-    m_motors_list = (Motor *)malloc(m_tot_nbr_motors * sizeof(Motor));
+    // Optional bus baudrate, to which BaseRobot migrates the motors
+    if (config["baudrate"])
+        m_bus_baudrate = config["baudrate"].as<int>();
+
+    // The motors are kept aside until the storage is allocated
+    m_parsed_motors = vector<Motor>(m_tot_nbr_motors);
 
     // Read the motors nodes: get the ID, model and multiturn mode for each motor
     for (int i = 0; i < config["motors"].size(); i++)
@@ -368,10 +694,14 @@ void Hal::parse_motor_config(char *config_file)
 
         // Convert the read node and update the list of used models
         motorNode2Motor(motor_node, motor);
+        if (motor.model == UNDEF_M) {
+            cout << "[KMR::dxl] Motor " << motor.id << ": unknown model " << motor_node.model_name << endl;
+            exit(1);
+        }
         update_unique_models_list(motor_node.model_name);
 
         // Populate the list of motors
-        m_motors_list[i] = motor;
+        m_parsed_motors[i] = motor;
     }
 }
 
@@ -409,7 +739,7 @@ void Hal::get_ID_list_from_motors_list()
     m_all_IDs = vector<int> (m_tot_nbr_motors);
 
     for (int i = 0; i < m_tot_nbr_motors; i++)
-        m_all_IDs[i] = m_motors_list[i].id;
+        m_all_IDs[i] = m_motor_ids[i];
 }
 
 
@@ -424,10 +754,14 @@ void Hal::get_ID_list_from_motors_list()
  * @param[in]   field Control field of the query
  * @retval      Control parameters of the query field
  */
-Motor_data_field Hal::getControlParametersFromID(int id, Fields field)
+Motor_data_field Hal::getControlParametersFromID(int id, Fields field) const
 {
     Motor_models model = getModelFromID(id);
-    Motor_data_field params = m_control_table[model][field];
+    if (model == UNDEF_M) {
+        cout << "[KMR::dxl] Motor " << id << " is not in the motors config file!" << endl;
+        exit(1);
+    }
+    Motor_data_field params = controlParameters(model, field);
 
     return params;
 }
@@ -437,49 +771,51 @@ Motor_data_field Hal::getControlParametersFromID(int id, Fields field)
  * @param[in]   id ID of the query motor
  * @retval      Model of the query motor
  */
-Motor_models Hal::getModelFromID(int id)
+Motor_models Hal::getModelFromID(int id) const
 {
-    Motor_models motor_model = NBR_MODELS;
+    int idx = getMotorsListIndexFromID(id);
+    if (idx == m_tot_nbr_motors)
+        return UNDEF_M;
 
-    for (int i = 0; i < m_tot_nbr_motors; i++)
-    {
-        if (m_motors_list[i].id == id)
-        {
-            motor_model = m_motors_list[i].model;
-            break;
-        }
-    }
-    return motor_model;
+    return m_motor_models[idx];
 }
 
 /**
  * @brief       Get a motor's list index from its ID
  * @param[in]   id ID of the query motor
- * @retval      Index of the query motor
+ * @retval      Index of the query motor, m_tot_nbr_motors if the motor is unknown
  */
-int Hal::getMotorsListIndexFromID(int id)
+int Hal::getMotorsListIndexFromID(int id) const
 {
-    int i;
-    for (i=0; i < m_tot_nbr_motors; i++)
-    {
-        if (m_motors_list[i].id == id)
-        {
-            break;
-        }
-    }
+    if (id < 0 || id >= NBR_IDS || m_idx_from_id[id] == -1)
+        return m_tot_nbr_motors;
 
-    return i;
+    return m_idx_from_id[id];
 }
 
 /**
  * @brief       Get a motor's info structure from motor ID
  * @param[in]   id ID of the query motor
- * @retval      The Motor structure of the query motor
+ * @retval      Copy of the query motor's info, assembled from the Hal's arrays
  */
-Motor Hal::getMotorFromID(int id)
+Motor Hal::getMotorFromID(int id) const
 {
-    int motor_idx = getMotorsListIndexFromID(id);
-    Motor motor = m_motors_list[motor_idx];
+    int idx = getMotorsListIndexFromID(id);
+    Motor motor;
+
+    if (idx == m_tot_nbr_motors) {
+        cout << "[KMR::dxl] Motor " << id << " is not in the motors config file!" << endl;
+        exit(1);
+    }
+
+    motor.id = m_motor_ids[idx];
+    motor.model = m_motor_models[idx];
+    motor.multiturn = m_multiturn[idx];
+    motor.control_modes = m_controlModesPerModel[motor.model];
+    motor.indir_address_offset = m_indir_address_offsets[idx];
+    motor.indir_data_offset = m_indir_data_offsets[idx];
+    motor.scanned_model = m_scanned_models[idx];
+    motor.toReset = m_reset_status[idx];
 
     return motor;
 }
@@ -498,33 +834,62 @@ Motor Hal::getMotorFromID(int id)
 void Hal::updateResetStatus(int id, int status)
 {
     int idx = getMotorsListIndexFromID(id);
-    m_motors_list[idx].toReset = status;
+    if (idx == m_tot_nbr_motors) {
+        cout << "[KMR::dxl] Motor " << id << " is not in the motors config file!" << endl;
+        exit(1);
+    }
+    m_reset_status[idx] = status;
 }
 
+/**
+ * @brief       Save the model number read from a motor during the communication check
+ * @param[in]   id ID of the query motor
+ * @param[in]   model_number Dynamixel-defined model number returned by the motor
+ * @retval      void
+ */
+void Hal::updateScannedModel(int id, int model_number)
+{
+    int idx = getMotorsListIndexFromID(id);
+    if (idx == m_tot_nbr_motors) {
+        cout << "[KMR::dxl] Motor " << id << " is not in the motors config file!" << endl;
+        exit(1);
+    }
+    m_scanned_models[idx] = model_number;
+}
 
 /**
- * @brief       For each motor, save all operating modes control values. \n 
- *              Needed for resetting in multiturn mode
+ * @brief       Update the status return settings of the motors, as configured by the robot
+ * @param[in]   level Status return level of all motors (0: no reply, 1: reply to READ only, 2: reply to all)
+ * @param[in]   max_return_delay Largest return delay time of the motors, in seconds
  * @retval      void
  */
-void Hal::saveControlValuesToMotors()
+void Hal::updateStatusReturn(int level, float max_return_delay)
 {
-    int idx, id, model;
+    m_status_return_level = level;
+    m_max_return_delay = max_return_delay;
+}
 
-    for (int i=0; i<m_tot_nbr_motors; i++){
-        id = m_all_IDs[i];
-        idx = getMotorsListIndexFromID(id);
-        model = m_motors_list[idx].model;
+/**
+ * @brief       Track the continuous position of a multiturn motor from a read hardware position. \n 
+ *              A change of more than half a turn since the last read is taken as a jump of the 
+ *              hardware position by whole turns (eg multiturn reset), added to the turn offset
+ * @param[in]   motor_idx Index of the motor in the motors list
+ * @param[in]   position Read hardware position
+ * @retval      void
+ */
+void Hal::trackPosition(int motor_idx, int position)
+{
+    int resolution = m_positionCodecsPerModel[m_motor_models[motor_idx]].resolution;
 
-        m_motors_list[idx].control_modes.current_based_position_control = 
-                            m_controlModesPerModel[model].current_based_position_control;
-        m_motors_list[idx].control_modes.position_control = m_controlModesPerModel[model].position_control;
-        m_motors_list[idx].control_modes.current_control = m_controlModesPerModel[model].current_control;
-        m_motors_list[idx].control_modes.multiturn_control = m_controlModesPerModel[model].multiturn_control;
-        m_motors_list[idx].control_modes.PWM_control = m_controlModesPerModel[model].PWM_control;
-        m_motors_list[idx].control_modes.velocity_control= m_controlModesPerModel[model].velocity_control;
+    if (m_position_tracked[motor_idx]) {
+        int delta = position - m_last_positions[motor_idx];
+        int turns = (int) lround((double) delta / resolution);
+        m_turn_offsets[motor_idx] -= turns * resolution;
     }
+
+    m_last_positions[motor_idx] = position;
+    m_position_tracked[motor_idx] = 1;
 }
-       
+
 
 }
\ No newline at end of file
@@ -37,11 +37,11 @@ namespace KMR::dxlP1
 
 
 /**
- * @brief       Check if the motors are compatible for a given field: same address for data storing
- * @param[in]   field Control field that the handler is taking care of
- * @retval      void
+ * @brief       Get the address of a field, checking that all handled motors store it at the same address
+ * @param[in]   field Query control field
+ * @retval      Address of the field in the handled motors' control tables
  */
-void Handler::checkMotorCompatibility(Fields field)
+uint8_t Handler::getFieldAddress(Fields field)
 {
     uint8_t address = -1;
     uint8_t address_prev = -1;
@@ -50,35 +50,34 @@ void Handler::checkMotorCompatibility(Fields field)
     for(int i=1; i<m_ids.size(); i++){
         id = m_ids[i];
         id_prev = m_ids[i-1];
-        address = m_hal.getControlParametersFromID(id, field).address;
-        address_prev = m_hal.getControlParametersFromID(id_prev, field).address;
+        address = m_hal->getControlParametersFromID(id, field).address;
+        address_prev = m_hal->getControlParametersFromID(id_prev, field).address;
 
         if(address != address_prev){
             cout << "Motors " << id << " and " << id_prev << " have incompatible addresses!" << endl;
             exit(1);
         }
-    }                                                                                                                                                                                                                                                                                                                        
+    }
 
     if (m_ids.size() == 1)
-        address = m_hal.getControlParametersFromID(m_ids[0], field).address;
+        address = m_hal->getControlParametersFromID(m_ids[0], field).address;
 
-    m_data_address = address;
+    return address;
 }
 
-
 /**
- * @brief       Calculate and store the byte length of data read/written by the handler. \n 
- *              Also check if the motors are field-compatible (same data lengths required for a given field)
- * @retval      void
+ * @brief       Get the byte length of a field, checking that it is the same for all handled motors
+ *              and that the field exists in their control tables
+ * @param[in]   field Query control field
+ * @retval      Byte length of the field
  */
-void Handler::getDataByteSize()
+uint8_t Handler::getFieldLength(Fields field)
 {
     uint8_t length = 0, length_prev = 0;
-    Fields field = m_field;
     
     for (int j=1; j<m_ids.size(); j++){
-        length = m_hal.getControlParametersFromID(m_ids[j], field).length;
-        length_prev = m_hal.getControlParametersFromID(m_ids[j-1], field).length;       
+        length = m_hal->getControlParametersFromID(m_ids[j], field).length;
+        length_prev = m_hal->getControlParametersFromID(m_ids[j-1], field).length;       
 
         if(length != length_prev){
             cout << "Motors " << m_ids[j] << " and " << m_ids[j-1] << " have incompatible field lengths!" << endl;
@@ -87,10 +86,131 @@ void Handler::getDataByteSize()
     }
 
     if (m_ids.size() == 1)
-        length = m_hal.getControlParametersFromID(m_ids[0], field).length;
+        length = m_hal->getControlParametersFromID(m_ids[0], field).length;
+
+    if (length == 0) {
+        cout << "Error: field " << field << " is not in the control table of the handled motors!" << endl;
+        exit(1);
+    }
+
+    return length;
+}
+
+/**
+ * @brief       Check if the motors are compatible for a given field: same address for data storing
+ * @param[in]   field Control field that the handler is taking care of
+ * @retval      void
+ */
+void Handler::checkMotorCompatibility(Fields field)
+{
+    m_data_address = getFieldAddress(field);
+}
 
-    m_data_byte_size += length;
 
+/**
+ * @brief       Calculate and store the byte length of data read/written by the handler. \n 
+ *              Also check if the motors are field-compatible (same data lengths required for a given field)
+ * @retval      void
+ */
+void Handler::getDataByteSize()
+{
+    m_data_byte_size += getFieldLength(m_field);
+}
+
+/**
+ * @brief       Resolve once everything the reading/writing hot paths need for each handled motor: 
+ *              index in the Hal, field unit, conversion type and model constants. \n 
+ *              Also fill the dense ID->slot lookup table
+ * @note        To be called once the handled IDs and field are set
+ * @retval      void
+ */
+void Handler::buildPlan()
+{
+    int id;
+
+    for (int i=0; i<NBR_IDS; i++)
+        m_slot_from_id[i] = -1;
+
+    for (int i=0; i<m_ids.size(); i++) {
+        id = m_ids[i];
+        if (id < 0 || id >= NBR_IDS) {
+            cout << "Error: motor ID " << id << " is out of range!" << endl;
+            exit(1);
+        }
+        m_slot_from_id[id] = i;
+    }
+
+    m_plan = buildFieldPlan(m_field);
+}
+
+/**
+ * @brief       Resolve the info of each handled motor for a given field
+ * @param[in]   field Query control field
+ * @retval      Resolved info of each handled motor, same order as m_ids
+ */
+vector<Motor_plan> Handler::buildFieldPlan(Fields field)
+{
+    vector<Motor_plan> field_plan(m_ids.size());
+    Motor_plan plan = {};
+    Motor_models model;
+    int id;
+
+    for (int i=0; i<m_ids.size(); i++) {
+        id = m_ids[i];
+
+        plan.hal_idx = m_hal->getMotorsListIndexFromID(id);
+        model = m_hal->m_motor_models[plan.hal_idx];
+        plan.unit = m_hal->getControlParametersFromID(id, field).unit;
+        plan.multiturn = m_hal->m_multiturn[plan.hal_idx];
+        plan.unwrapped = plan.multiturn && (field == GOAL_POS || field == PRESENT_POS);
+
+        plan.codec = FIELD_INFOS[field].codec;
+
+        const Position_codec& position_codec = m_hal->positionCodec(model);
+        if (plan.codec == ANGLE_CODEC && position_codec.resolution <= 0) {
+            cout << "Motor " << id << ": model " << MOTOR_MODEL_NAMES[model] 
+                 << " has no position codec, cannot convert between positions and angles!" << endl;
+            exit(1);
+        }
+        if (plan.codec == ANGLE_CODEC && plan.multiturn && position_codec.multiturn_max <= position_codec.multiturn_min) {
+            cout << "Motor " << id << ": model " << MOTOR_MODEL_NAMES[model] << " does not support multiturn!" << endl;
+            exit(1);
+        }
+
+        plan.center = position_codec.center;
+        plan.min_position = position_codec.min_position;
+        plan.max_position = position_codec.max_position;
+        // Reset only when a turn away from the ends of the multiturn range
+        plan.reset_min = position_codec.multiturn_min + position_codec.resolution;
+        plan.reset_max = position_codec.multiturn_max - position_codec.resolution;
+
+        field_plan[i] = plan;
+    }
+
+    return field_plan;
+}
+
+/**
+ * @brief       Check once a set of motors to be read/written at each control step
+ * @param[in]   ids List of motors of the set
+ * @retval      Prepared set, to be passed to this handler's reading/writing methods
+ */
+Prepared_ids Handler::prepareIDs(std::span<const int> ids)
+{
+    checkIDvalidity(ids);
+
+    Prepared_ids set;
+    set.ids = vector<int>(ids.begin(), ids.end());
+    set.handler = this;
+    set.serial = ++m_nbr_prepared;
+
+    // Does the set contain each handled motor?
+    vector<int> sorted_ids = set.ids;
+    std::sort(sorted_ids.begin(), sorted_ids.end());
+    sorted_ids.erase(std::unique(sorted_ids.begin(), sorted_ids.end()), sorted_ids.end());
+    set.all_handled = (sorted_ids.size() == m_ids.size());
+
+    return set;
 }
 
 /*
@@ -103,16 +223,29 @@ void Handler::getDataByteSize()
  * @param[in]   ids List of query motors
  * @retval      void
  */
-void Handler::checkIDvalidity(vector<int> ids)
+void Handler::checkIDvalidity(std::span<const int> ids)
 {
     for(int i=0; i<ids.size(); i++){
-        if ( find(m_ids.begin(), m_ids.end(), ids[i]) == m_ids.end() ) {
+        if (ids[i] < 0 || ids[i] >= NBR_IDS || m_slot_from_id[ids[i]] == -1) {
             cout << "Error: motor " << ids[i] << " is not handled by this handler!" << endl;  
             exit(1);
         }
     }
 }
 
+/**
+ * @brief       Check if a prepared set of motors was created by this specific handler
+ * @param[in]   set Query prepared set
+ * @retval      void
+ */
+void Handler::checkPreparedIDs(const Prepared_ids& set)
+{
+    if (set.handler != this) {
+        cout << "Error: this set of motors was not prepared for this handler!" << endl;  
+        exit(1);
+    }
+}
+
 /**
  * @brief       Check if query field is handled by this specific handler
  * @param[in]   field Query control field
@@ -120,12 +253,27 @@ void Handler::checkIDvalidity(vector<int> ids)
  */
 void Handler::checkFieldValidity(Fields field)
 {
-    if (field != m_field) {
+    if (std::find(m_fields.begin(), m_fields.end(), field) == m_fields.end()) {
         cout << "Error: field " << field << " is not handled by this handler!" << endl;  
         exit(1);
     }
 }
 
+/**
+ * @brief       Check if the handled motors' field length is the one expected at compile time
+ * @note        Used by the typed handlers, whose byte size is fixed by Field_traits
+ * @param[in]   length Expected byte size of the handled field
+ * @retval      void
+ */
+void Handler::checkFieldLength(int length)
+{
+    if (m_data_byte_size != length) {
+        cout << "Error: field " << m_field << " is " << (int) m_data_byte_size 
+             << " bytes long in the control table, " << length << " expected!" << endl;
+        exit(1);
+    }
+}
+
 
 /**
  * @brief       Get the index of a motor in the list of handled motors
@@ -134,12 +282,7 @@ void Handler::checkFieldValidity(Fields field)
  */
 int Handler::getMotorIndexFromID(int id)
 {
-    int idx = 0;
-
-    while(m_ids[idx] != id)
-        idx++;
-
-    return idx; 
+    return m_slot_from_id[id];
 }
 
 }
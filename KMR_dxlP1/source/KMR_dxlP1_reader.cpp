@@ -14,10 +14,18 @@
 
 #include "KMR_dxlP1_reader.hpp"
 #include <algorithm>
+#include <climits>
 #include <cstdint>
+#include <cstring>
+#include <limits>
 
-#define MAX_POS         28672
-#define UINT_OVERFLOW   65535
+#define BULK_READ_OVERHEAD      7   // Header(2) + ID + LEN + INST + 0x00 + CHECKSUM
+#define BULK_READ_PARAM_SIZE    3   // DATA_LEN + ID + ADDR per motor
+#define STATUS_OVERHEAD         6   // Header(2) + ID + LEN + ERROR + CHECKSUM
+#define RX_SLACK                32  // Room for unexpected bytes in the replies stream
+#define SNAPSHOT_FRESH          4   // Flag of a published snapshot not taken yet by the consumer
+#define SNAPSHOT_INDEX          3   // Mask of the snapshot index
+#define USB_LATENCY_MS          16  // USB latency timer margin, as in the SDK's packet timeout
 
 using std::cout;
 using std::endl;
@@ -29,30 +37,112 @@ namespace KMR::dxlP1
 
 /**
  * @brief       Constructor for a Reader handler
- * @param[in]   list_fields List of fields to be handled by the reader
+ * @param[in]   field Field to be handled by the reader
  * @param[in]   ids Motors to be handled by the reader
  * @param[in]   portHandler Object handling port communication
  * @param[in]   packetHandler Object handling packets
- * @param[in]   hal Previouly initialized Hal object
+ * @param[in]   hal Previously initialized Hal object, shared by all handlers
  */
 Reader::Reader(Fields field, vector<int> ids, dynamixel::PortHandler *portHandler,
-                            dynamixel::PacketHandler *packetHandler, Hal hal)
+                            dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal)
+: Reader(vector<Fields>{field}, ids, portHandler, packetHandler, hal)
+{
+}
+
+/**
+ * @brief       Constructor for a Reader handler of several fields
+ * @note        All fields are read at once: the reader fetches, from each motor, the address span 
+ *              going from the first to the last byte of the handled fields, gaps included. \n
+ *              Fields close in the control table (eg PRESENT_POS to PRESENT_TEMP) are thus 
+ *              read for the cost of a single one
+ * @param[in]   list_fields List of fields to be handled by the reader
+ * @param[in]   ids Motors to be handled by the reader
+ * @param[in]   portHandler Object handling port communication
+ * @param[in]   packetHandler Object handling packets
+ * @param[in]   hal Previously initialized Hal object, shared by all handlers
+ */
+Reader::Reader(vector<Fields> list_fields, vector<int> ids, dynamixel::PortHandler *portHandler,
+                            dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal)
 {
     portHandler_ = portHandler;
     packetHandler_ = packetHandler;
     m_hal = hal;
     m_ids = ids;
 
-    m_field = field;
+    if (list_fields.empty()) {
+        cout << "[KMR::dxlP1::Reader] At least one field needs to be handled!" << endl;
+        exit(1);
+    }
+    m_fields = list_fields;
+    m_field = list_fields[0];
+
+    buildPlan();
+
+    // Locate each field, and the span covering them all
+    int span_start = INT_MAX, span_end = 0;
+    m_read_fields = vector<Read_field>(m_fields.size());
 
-    getDataByteSize();
-    checkMotorCompatibility(field);
+    for (int i=0; i<m_fields.size(); i++) {
+        if (std::find(m_fields.begin(), m_fields.begin()+i, m_fields[i]) != m_fields.begin()+i) {
+            cout << "[KMR::dxlP1::Reader] Field " << m_fields[i] << " is handled twice!" << endl;
+            exit(1);
+        }
 
-    m_groupBulkReader = new dynamixel::GroupBulkRead(portHandler_, packetHandler_);
+        m_read_fields[i].field = m_fields[i];
+        m_read_fields[i].address = getFieldAddress(m_fields[i]);
+        m_read_fields[i].length = getFieldLength(m_fields[i]);
+        m_read_fields[i].plan = (i == 0) ? m_plan : buildFieldPlan(m_fields[i]);
+
+        // Decoding constants, contiguous for batch conversions
+        const vector<Motor_plan>& plan = m_read_fields[i].plan;
+        m_read_fields[i].units = vector<float>(m_ids.size());
+        m_read_fields[i].centers = vector<int32_t>(m_ids.size());
+        m_read_fields[i].unwrapped = false;
+        for (int j=0; j<m_ids.size(); j++) {
+            m_read_fields[i].units[j] = plan[j].unit;
+            m_read_fields[i].centers[j] = (plan[j].codec == ANGLE_CODEC) ? plan[j].center : 0;
+            m_read_fields[i].unwrapped |= plan[j].unwrapped;
+        }
+        if (m_fields[i] == PRESENT_POS && m_read_fields[i].unwrapped)
+            m_tracked_field = i;
 
-    // Create the table to save read data
-    m_dataFromMotor = new float [m_ids.size()];                          
+        span_start = std::min(span_start, (int) m_read_fields[i].address);
+        span_end = std::max(span_end, m_read_fields[i].address + m_read_fields[i].length);
+    }
 
+    m_data_address = span_start;
+    m_data_byte_size = span_end - span_start;
+
+    // Request and replies buffers, sized for all handled motors
+    m_request = new uint8_t[BULK_READ_OVERHEAD + BULK_READ_PARAM_SIZE*m_ids.size()];
+    m_rx_buffer = new uint8_t[(STATUS_OVERHEAD + m_data_byte_size) * m_ids.size() + RX_SLACK];
+    m_rawData = new uint8_t[m_data_byte_size * m_ids.size()]();
+    m_received = new uint8_t[m_ids.size()]();
+    m_rawPerField = new int32_t[m_fields.size() * m_ids.size()]();
+    m_gathered_seq = new uint64_t[m_fields.size()]();
+    m_decoded_seq = new uint64_t[m_fields.size()]();
+    m_pending_ids = new int[m_ids.size()];
+    m_retry_ids = new int[m_ids.size()];
+    m_sample_stamps = new std::chrono::steady_clock::time_point[m_ids.size()]();
+    m_turn_offsets = new int32_t[m_ids.size()]();
+
+    // Create the tables to save read data
+    m_dataPerField = new float* [m_fields.size()];
+    for (int i=0; i<m_fields.size(); i++)
+        m_dataPerField[i] = new float [m_ids.size()]();
+    m_dataFromMotor = m_dataPerField[0];
+
+    // Published snapshots
+    for (int i=0; i<3; i++) {
+        m_snapshots[i].raw = new uint8_t [m_data_byte_size * m_ids.size()]();
+        m_snapshots[i].received = new uint8_t [m_ids.size()]();
+        m_snapshots[i].sample_stamps = new std::chrono::steady_clock::time_point [m_ids.size()]();
+        m_snapshots[i].turn_offsets = new int32_t [m_ids.size()]();
+        m_snapshots[i].params = new int32_t [m_fields.size() * m_ids.size()]();
+        m_snapshots[i].data = new float [m_fields.size() * m_ids.size()]();
+        m_snapshots[i].gathered = new uint8_t [m_fields.size()]();
+        m_snapshots[i].decoded = new uint8_t [m_fields.size()]();
+    }
 }
 
 
@@ -61,7 +151,32 @@ Reader::Reader(Fields field, vector<int> ids, dynamixel::PortHandler *portHandle
  */
 Reader::~Reader()
 {
-    //cout << "The Dxl Reader object is being deleted" << endl;
+    delete[] m_request;
+    delete[] m_rx_buffer;
+    delete[] m_rawData;
+    delete[] m_received;
+    delete[] m_rawPerField;
+    delete[] m_gathered_seq;
+    delete[] m_decoded_seq;
+    delete[] m_pending_ids;
+    delete[] m_retry_ids;
+    delete[] m_sample_stamps;
+    delete[] m_turn_offsets;
+
+    for (int i=0; i<m_fields.size(); i++)
+        delete[] m_dataPerField[i];
+    delete[] m_dataPerField;
+
+    for (int i=0; i<3; i++) {
+        delete[] m_snapshots[i].raw;
+        delete[] m_snapshots[i].received;
+        delete[] m_snapshots[i].sample_stamps;
+        delete[] m_snapshots[i].turn_offsets;
+        delete[] m_snapshots[i].params;
+        delete[] m_snapshots[i].data;
+        delete[] m_snapshots[i].gathered;
+        delete[] m_snapshots[i].decoded;
+    }
 }
 
 /*
@@ -70,56 +185,464 @@ Reader::~Reader()
  ****************************************************************************/
 
 /**
- * @brief   Clear the parameters list: no motors added
+ * @brief   Forget the current bulk read request
  */
 void Reader::clearParam()
 {
-    m_groupBulkReader->clearParam();
+    m_request_size = 0;
+    m_registered_serial = 0;
+}
+
+/**
+ * @brief       Build the protocol 1 bulk read request of the handled span for input motors: \n
+ *              FF FF FE LEN 92 00 {DATA_LEN ID ADDR}... CHECKSUM
+ * @param[in]   ids List of motors whose fields will be read, already checked
+ * @retval      void
+ */
+void Reader::buildRequest(std::span<const int> ids)
+{
+    int params_length = 1 + BULK_READ_PARAM_SIZE*ids.size();
+    uint8_t checksum = 0;
+
+    if (ids.size() > m_ids.size()) {
+        cout << "[KMR::dxlP1::Reader] More motors to read than handled, check for duplicate IDs!" << endl;
+        exit(1);
+    }
+    if (m_hal->m_status_return_level == 0) {
+        cout << "[KMR::dxlP1::Reader] The motors' status return level is 0: they do not reply to reads!" << endl;
+        exit(1);
+    }
+
+    m_request[FRAME_HEADER0] = 0xFF;
+    m_request[FRAME_HEADER1] = 0xFF;
+    m_request[FRAME_ID] = BROADCAST_ID;
+    m_request[FRAME_LENGTH] = params_length + 2;
+    m_request[FRAME_INSTRUCTION] = INST_BULK_READ;
+    m_request[FRAME_PARAMETER0] = 0x00;
+
+    for (int i=0; i<ids.size(); i++) {
+        uint8_t *motor_params = m_request + FRAME_PARAMETER0 + 1 + i*BULK_READ_PARAM_SIZE;
+        motor_params[0] = m_data_byte_size;
+        motor_params[1] = ids[i];
+        motor_params[2] = m_data_address;
+    }
+
+    m_request_size = BULK_READ_OVERHEAD + BULK_READ_PARAM_SIZE*ids.size();
+    for (int i=FRAME_ID; i<m_request_size-1; i++)
+        checksum += m_request[i];
+    m_request[m_request_size-1] = ~checksum;
 }
 
 /**
- * @brief       Add a motor to the list of motors who will read
- * @param[in]   id ID of the motor
- * @retval      bool: true if motor added successfully
+ * @brief       Send the current bulk read request. The port stays in use until the replies are received
+ * @param[in]   ids List of motors whose fields will be read, as in the request
+ * @retval      int: communication result, as defined by the SDK
  */
-bool Reader::addParam(uint8_t id)
+int Reader::sendRequest(std::span<const int> ids)
 {
-    bool dxl_addparam_result = m_groupBulkReader->addParam(id, m_data_address, m_data_byte_size);
-    return dxl_addparam_result;
+    if (portHandler_->is_using_)
+        return COMM_PORT_BUSY;
+    portHandler_->is_using_ = true;
+
+    portHandler_->clearPort();
+    int written_length = portHandler_->writePort(m_request, m_request_size);
+    m_request_stamp = std::chrono::steady_clock::now();
+    if (written_length != m_request_size) {
+        portHandler_->is_using_ = false;
+        return COMM_TX_FAIL;
+    }
+
+    setReplyTimeout(getReplyLength(ids), ids);
+    return COMM_SUCCESS;
 }
 
 /**
- * @brief       Read the handled fields of input motors
- * @param[in]   ids List of motors whose fields will be read 
+ * @brief       Get the total byte size of the replies to a bulk read request
+ * @param[in]   ids List of motors whose fields are read, as in the request
+ * @retval      Byte size of the replies
+ */
+int Reader::getReplyLength(std::span<const int> ids)
+{
+    return (STATUS_OVERHEAD + m_data_byte_size) * ids.size();
+}
+
+/**
+ * @brief       Set the port's timeout for the replies to a bulk read request
+ * @note        Once the robot configured the motors' return delay time, each reply is given 
+ *              that delay on top of its transmission time. Otherwise, the SDK's default is used
+ * @param[in]   length Number of bytes to be transmitted until the last reply, request included
+ * @param[in]   ids List of motors whose fields are read, as in the request
  * @retval      void
  */
-void Reader::syncRead(vector<int> ids)
+void Reader::setReplyTimeout(int length, std::span<const int> ids)
 {
-    int dxl_comm_result = COMM_TX_FAIL;             // Communication result
-    bool dxl_addparam_result = 0;
-    uint8_t id;
+    if (m_hal->m_max_return_delay < 0) {
+        portHandler_->setPacketTimeout((uint16_t) length);
+        return;
+    }
+
+    double byte_time_ms = 10000.0 / portHandler_->getBaudRate();  // 10 bits per byte
+    double timeout_ms = byte_time_ms*length + ids.size()*m_hal->m_max_return_delay*1000 + 2*USB_LATENCY_MS + 2;
+    portHandler_->setPacketTimeout(timeout_ms);
+}
 
-    clearParam();    
+/**
+ * @brief       Receive the replies of input motors to a bulk read request, and save their data
+ * @note        The replies are read as one stream, parsed once the expected length is reached. \n 
+ *              Reading goes on if some replies are still missing (eg noise on the bus), until timeout
+ * @param[in]   ids List of motors whose fields are read, as in the request
+ * @retval      int: communication result, as defined by the SDK
+ */
+int Reader::receiveReplies(std::span<const int> ids)
+{
+    int expected_length = getReplyLength(ids);
+    int capacity = getReplyLength(m_ids) + RX_SLACK;
+    int rx_length = 0;
+    int nbr_received = 0;
 
-    // Add the input motors to the reading list
-    for (int i=0; i<ids.size(); i++){
-        id = (uint8_t)ids[i];
-        dxl_addparam_result = addParam(id);
-        if (dxl_addparam_result != true) {
-            cout << "[KMR::dxlP1::Reader] Adding parameters failed for ID = " << ids[i] << endl;
-            exit(1);
+    for (int i=0; i<ids.size(); i++)
+        m_received[m_slot_from_id[ids[i]]] = 0;
+
+    while (true) {
+        rx_length += portHandler_->readPort(m_rx_buffer + rx_length, capacity - rx_length);
+
+        if (rx_length >= expected_length) {
+            nbr_received = parseReplies(rx_length);
+            if (nbr_received >= ids.size())
+                break;
+        }
+        if (portHandler_->isPacketTimeout() || rx_length == capacity) {
+            nbr_received = parseReplies(rx_length);
+            break;
+        }
+    }
+
+    if (nbr_received >= ids.size())
+        return COMM_SUCCESS;
+    else if (rx_length == 0)
+        return COMM_RX_TIMEOUT;
+    else
+        return COMM_RX_CORRUPT;
+}
+
+/**
+ * @brief       Parse the stream of status packets received after a bulk read request. \n 
+ *              Each valid packet of a handled motor is copied into the motor's read span
+ * @param[in]   rx_length Number of bytes received
+ * @retval      int: number of valid packets of handled motors
+ */
+int Reader::parseReplies(int rx_length)
+{
+    int pos = 0;
+    int nbr_valid = 0;
+
+    while (pos + STATUS_OVERHEAD <= rx_length) {
+        const uint8_t *packet = m_rx_buffer + pos;
+
+        // Look for the next header
+        if (packet[FRAME_HEADER0] != 0xFF || packet[FRAME_HEADER1] != 0xFF || packet[FRAME_ID] == 0xFF) {
+            pos++;
+            continue;
+        }
+
+        int packet_size = packet[FRAME_LENGTH] + 4;
+        if (pos + packet_size > rx_length)
+            break;
+
+        uint8_t checksum = 0;
+        for (int i=FRAME_ID; i<packet_size-1; i++)
+            checksum += packet[i];
+        if ((uint8_t) ~checksum != packet[packet_size-1]) {
+            pos++;
+            continue;
+        }
+
+        int motor_idx = m_slot_from_id[packet[FRAME_ID]];
+        if (motor_idx != -1 && packet_size == STATUS_OVERHEAD + m_data_byte_size) {
+            memcpy(m_rawData + motor_idx*m_data_byte_size, packet + FRAME_PARAMETER0, m_data_byte_size);
+            m_received[motor_idx] = 1;
+            m_sample_stamps[motor_idx] = m_request_stamp;
+            nbr_valid++;
+        }
+
+        pos += packet_size;
+    }
+
+    return nbr_valid;
+}
+
+/**
+ * @brief       Receive the replies to a sent request, release the port, re-read the failed motors 
+ *              if retries are enabled, and save the read data into the output matrix
+ * @param[in]   ids List of motors whose fields are read, as in the request
+ * @retval      int: communication result, as defined by the SDK
+ */
+int Reader::collectReplies(std::span<const int> ids)
+{
+    int dxl_comm_result = receiveReplies(ids);
+    portHandler_->is_using_ = false;
+
+    if (dxl_comm_result != COMM_SUCCESS && m_max_retries > 0)
+        dxl_comm_result = retryFailedReads(ids);
+
+    completeRead(ids);
+
+    return dxl_comm_result;
+}
+
+/**
+ * @brief       Read again the input motors that did not reply, as long as the retry budget allows
+ * @note        The request is rebuilt for the failed motors only: the cached request is dropped
+ * @param[in]   ids List of motors of the read
+ * @retval      int: communication result of the last re-read, as defined by the SDK
+ */
+int Reader::retryFailedReads(std::span<const int> ids)
+{
+    int dxl_comm_result = COMM_RX_FAIL;
+    auto read_stamp = m_request_stamp;
+
+    for (int attempt=0; attempt<m_max_retries; attempt++) {
+        if (std::chrono::steady_clock::now() - read_stamp >= m_retry_budget)
+            break;
+
+        int nbr_failed = 0;
+        for (int i=0; i<ids.size(); i++) {
+            if (!m_received[m_slot_from_id[ids[i]]])
+                m_retry_ids[nbr_failed++] = ids[i];
         }
+        std::span<const int> failed_ids(m_retry_ids, nbr_failed);
+
+        buildRequest(failed_ids);
+        m_registered_serial = 0;
+
+        dxl_comm_result = sendRequest(failed_ids);
+        if (dxl_comm_result != COMM_SUCCESS)
+            break;
+        dxl_comm_result = receiveReplies(failed_ids);
+        portHandler_->is_using_ = false;
+
+        if (dxl_comm_result == COMM_SUCCESS)
+            break;
+    }
+
+    // The read is dated by its first request
+    m_request_stamp = read_stamp;
+    return dxl_comm_result;
+}
+
+/**
+ * @brief       Report the missing replies, save the read data into the output matrix and 
+ *              publish it as a snapshot
+ * @param[in]   ids List of motors of the read
+ * @retval      void
+ */
+void Reader::completeRead(std::span<const int> ids)
+{
+    checkReadSuccessful(ids);
+    m_nbr_reads++;
+    trackPositions(ids);
+    populateOutputMatrix();
+    publishSnapshot(ids);
+}
+
+/**
+ * @brief       Mark the input motors as not read, the request having failed to be sent
+ * @param[in]   ids List of motors whose fields were to be read
+ * @retval      void
+ */
+void Reader::discardReplies(std::span<const int> ids)
+{
+    for (int i=0; i<ids.size(); i++)
+        m_received[m_slot_from_id[ids[i]]] = 0;
+
+    completeRead(ids);
+}
+
+/**
+ * @brief       Send the current request and save the replies of input motors
+ * @param[in]   ids List of motors whose fields will be read, as in the request
+ * @retval      void
+ */
+void Reader::readRegistered(std::span<const int> ids)
+{
+    if (m_nbr_pending != -1) {
+        cout << "[KMR::dxlP1::Reader] A read was started: collect it first!" << endl;
+        exit(1);
     }
 
+    int dxl_comm_result = COMM_TX_FAIL;             // Communication result
+
     // Read the motors' sensors
-    dxl_comm_result = m_groupBulkReader->txRxPacket();
+    dxl_comm_result = sendRequest(ids);
+    if (dxl_comm_result == COMM_SUCCESS)
+        dxl_comm_result = collectReplies(ids);
+    else
+        discardReplies(ids);
+
     if (dxl_comm_result != COMM_SUCCESS){
         cout << packetHandler_->getTxRxResult(dxl_comm_result) << endl;
         //exit(1);
     }
+}
 
-    checkReadSuccessful(ids);
-    populateOutputMatrix(ids);
+/**
+ * @brief       Read the handled fields of input motors
+ * @param[in]   ids List of motors whose fields will be read 
+ * @retval      void
+ */
+void Reader::syncRead(std::span<const int> ids)
+{
+    checkIDvalidity(ids);
+
+    buildRequest(ids);
+    m_registered_serial = 0;
+
+    readRegistered(ids);
+}
+
+/**
+ * @brief       Read the handled fields of a prepared set of motors
+ * @note        The request is only rebuilt when a different set is read
+ * @param[in]   set Motors whose fields will be read, prepared with prepareIDs
+ * @retval      void
+ */
+void Reader::syncRead(const Prepared_ids& set)
+{
+    checkPreparedIDs(set);
+
+    if (m_registered_serial != set.serial) {
+        buildRequest(set.ids);
+        m_registered_serial = set.serial;
+    }
+
+    readRegistered(set.ids);
+}
+
+
+/*
+ *****************************************************************************
+ *                          Split-phase data reading
+ ****************************************************************************/
+
+/**
+ * @brief       Start reading the handled fields of all handled motors: send the request and return
+ *              without waiting for the replies, to be saved later with collect
+ * @note        The port stays in use until collect is called: no other transaction can 
+ *              be done on it in between
+ * @retval      void
+ */
+void Reader::beginRead()
+{
+    if (m_registered_serial != ALL_HANDLED_SERIAL) {
+        buildRequest(m_ids);
+        m_registered_serial = ALL_HANDLED_SERIAL;
+    }
+
+    beginRegistered(m_ids);
+}
+
+/**
+ * @brief       Start reading the handled fields of input motors: send the request and return
+ *              without waiting for the replies, to be saved later with collect
+ * @note        The port stays in use until collect is called: no other transaction can 
+ *              be done on it in between
+ * @param[in]   ids List of motors whose fields will be read 
+ * @retval      void
+ */
+void Reader::beginRead(std::span<const int> ids)
+{
+    checkIDvalidity(ids);
+
+    buildRequest(ids);
+    m_registered_serial = 0;
+
+    beginRegistered(ids);
+}
+
+/**
+ * @brief       Start reading the handled fields of a prepared set of motors: send the request and 
+ *              return without waiting for the replies, to be saved later with collect
+ * @note        The port stays in use until collect is called: no other transaction can 
+ *              be done on it in between
+ * @param[in]   set Motors whose fields will be read, prepared with prepareIDs
+ * @retval      void
+ */
+void Reader::beginRead(const Prepared_ids& set)
+{
+    checkPreparedIDs(set);
+
+    if (m_registered_serial != set.serial) {
+        buildRequest(set.ids);
+        m_registered_serial = set.serial;
+    }
+
+    beginRegistered(set.ids);
+}
+
+/**
+ * @brief       Send the current request, keeping note of the motors whose replies are to be collected
+ * @param[in]   ids List of motors whose fields will be read, as in the request
+ * @retval      void
+ */
+void Reader::beginRegistered(std::span<const int> ids)
+{
+    int dxl_comm_result = COMM_TX_FAIL;
+
+    if (m_nbr_pending != -1) {
+        cout << "[KMR::dxlP1::Reader] A read was already started: collect it first!" << endl;
+        exit(1);
+    }
+
+    for (int i=0; i<ids.size(); i++)
+        m_pending_ids[i] = ids[i];
+    m_nbr_pending = ids.size();
+
+    dxl_comm_result = sendRequest(ids);
+    if (dxl_comm_result != COMM_SUCCESS) {
+        cout << packetHandler_->getTxRxResult(dxl_comm_result) << endl;
+        m_pending_comm_result = dxl_comm_result;
+    }
+    else
+        m_pending_comm_result = COMM_SUCCESS;
+}
+
+/**
+ * @brief       Save the replies to the read started with beginRead into the output matrix
+ * @retval      bool: true if all motors of the read replied
+ */
+bool Reader::collect()
+{
+    int dxl_comm_result = COMM_TX_FAIL;
+
+    if (m_nbr_pending == -1) {
+        cout << "[KMR::dxlP1::Reader] No read to be collected!" << endl;
+        return false;
+    }
+
+    std::span<const int> ids(m_pending_ids, m_nbr_pending);
+    m_nbr_pending = -1;
+
+    // The request could not be sent
+    if (m_pending_comm_result != COMM_SUCCESS) {
+        discardReplies(ids);
+        return false;
+    }
+
+    dxl_comm_result = collectReplies(ids);
+
+    if (dxl_comm_result != COMM_SUCCESS)
+        cout << packetHandler_->getTxRxResult(dxl_comm_result) << endl;
+
+    return (dxl_comm_result == COMM_SUCCESS);
+}
+
+/**
+ * @brief       Check if a read was started with beginRead and not collected yet
+ * @retval      bool: true if a read waits to be collected
+ */
+bool Reader::isReadPending()
+{
+    return (m_nbr_pending != -1);
 }
 
 
@@ -128,14 +651,13 @@ void Reader::syncRead(vector<int> ids)
  * @param[in]   ids List of motors whose fields have just been read
  * @retval      void
  */
-void Reader::checkReadSuccessful(vector<int> ids)
+void Reader::checkReadSuccessful(std::span<const int> ids)
 {
     // Check if groupsyncread data of Dyanamixel is available
     bool dxl_getdata_result = false;
-    Fields field = m_field;
 
     for (int i=0; i<ids.size(); i++) {
-        dxl_getdata_result = m_groupBulkReader->isAvailable(ids[i], m_data_address, m_data_byte_size);
+        dxl_getdata_result = m_received[m_slot_from_id[ids[i]]];
 
         if (dxl_getdata_result != true)
         {
@@ -147,67 +669,321 @@ void Reader::checkReadSuccessful(vector<int> ids)
 
 
 /**
- * @brief       The reading being successful, save the read data into the output matrix
- * @param[in]   ids List of motors whose fields have been successfully read
+ * @brief       Save the read data of the first handled field into the output matrix, converted 
+ *              in one pass for all handled motors. The other fields are converted on access
+ * @note        Motors out of the read, or that did not reply, get their last valid values
  * @retval      void
  */
-void Reader::populateOutputMatrix(vector<int> ids)
+void Reader::populateOutputMatrix()
 {
-    Fields field = m_field;
-    uint32_t paramData;
-    float units, data;
-    int id = 0, idx = 0;
+    decodeField(0, getGatheredField(0), m_turn_offsets, m_dataPerField[0]);
+    m_decoded_seq[0] = m_nbr_reads;
+}
 
-    for (int i=0; i<ids.size(); i++) {
-        id = ids[i];
-        units = m_hal.getControlParametersFromID(id, field).unit;
+/**
+ * @brief       Get the parametrized values of a field from the read spans of all handled motors
+ * @param[in]   field_idx Index of the field in the list of handled fields
+ * @param[in]   raw Read spans of all handled motors (m_rawData or a snapshot's)
+ * @param[out]  params Parametrized values, same order as m_ids
+ * @retval      void
+ */
+void Reader::gatherField(int field_idx, const uint8_t *raw, int32_t *params)
+{
+    const Read_field& read_field = m_read_fields[field_idx];
+    bool is_signed = FIELD_INFOS[read_field.field].is_signed;
+    bool is_direction = (FIELD_INFOS[read_field.field].codec == DIRECTION_CODEC);
+    int nbr_motors = m_ids.size();
+
+    for (int idx=0; idx<nbr_motors; idx++)
+        params[idx] = getRawData(raw, idx, read_field.address, read_field.length);
+
+    // Speeds are sent as sign-magnitude, bit 10 being the direction
+    if (is_direction) {
+        for (int idx=0; idx<nbr_motors; idx++)
+            params[idx] = decodeDirection(params[idx]);
+    }
+    // Signed fields (eg multiturn positions) are sent as two's complement
+    else if (is_signed && read_field.length < 4)
+        signExtend(params, 8*read_field.length, nbr_motors);
+}
+
+/**
+ * @brief       Convert the parametrized values of a field to SI units
+ * @param[in]   field_idx Index of the field in the list of handled fields
+ * @param[in]   params Parametrized values, same order as m_ids
+ * @param[in]   turn_offsets Turn offsets of the motors at the time of the read, same order as m_ids
+ * @param[out]  data Values in SI units, same order as m_ids
+ * @retval      void
+ */
+void Reader::decodeField(int field_idx, const int32_t *params, const int32_t *turn_offsets, float *data)
+{
+    const Read_field& read_field = m_read_fields[field_idx];
 
-        paramData = m_groupBulkReader->getData(id, m_data_address, m_data_byte_size);
+    decodeScaled(params, read_field.centers.data(), read_field.units.data(), data, m_ids.size());
 
-        // Transform data from parametrized value to SI units
-        if (field != GOAL_POS && field != PRESENT_POS &&
-            field != CW_ANGLE_LIMIT && field != CCW_ANGLE_LIMIT) {
-            data = paramData * units;        
-        }
-        else {
-            // In multiturn mode, paramData overflows when position parameter < 0
-            if (paramData > MAX_POS)
-                paramData = paramData - UINT_OVERFLOW; 
-            data = position2Angle(paramData, id, units);
+    // Multiturn positions are continuous: hardware position + turn offset
+    if (read_field.unwrapped) {
+        for (int idx=0; idx<m_ids.size(); idx++) {
+            if (read_field.plan[idx].unwrapped)
+                data[idx] += turn_offsets[idx] * read_field.units[idx];
         }
-            
-        // Save the converted value into the output matrix
-        idx = getMotorIndexFromID(id);
-        m_dataFromMotor[idx] = data;
     }
 }
 
+/**
+ * @brief       Track the continuous positions of the multiturn motors from the last read, 
+ *              and save their turn offsets for the conversions of this read
+ * @param[in]   ids List of motors whose fields have been read
+ * @retval      void
+ */
+void Reader::trackPositions(std::span<const int> ids)
+{
+    if (m_tracked_field < 0)
+        return;
+
+    const Read_field& read_field = m_read_fields[m_tracked_field];
+    const int32_t *positions = getGatheredField(m_tracked_field);
+    int idx;
+
+    // Only the motors that replied to this read: others may have moved since their last reply
+    for (int i=0; i<ids.size(); i++) {
+        idx = m_slot_from_id[ids[i]];
+        if (read_field.plan[idx].unwrapped && m_received[idx])
+            m_hal->trackPosition(read_field.plan[idx].hal_idx, positions[idx]);
+    }
+
+    for (idx=0; idx<m_ids.size(); idx++) {
+        if (read_field.plan[idx].unwrapped)
+            m_turn_offsets[idx] = m_hal->turnOffsetAt(read_field.plan[idx].hal_idx);
+    }
+}
+
+/**
+ * @brief       Get the parametrized values of a field from the last read, gathered once per read
+ * @param[in]   field_idx Index of the field in the list of handled fields
+ * @retval      Parametrized values, same order as m_ids
+ */
+int32_t* Reader::getGatheredField(int field_idx)
+{
+    int32_t *params = m_rawPerField + field_idx*m_ids.size();
+
+    if (m_gathered_seq[field_idx] != m_nbr_reads) {
+        gatherField(field_idx, m_rawData, params);
+        m_gathered_seq[field_idx] = m_nbr_reads;
+    }
+
+    return params;
+}
+
+/**
+ * @brief       Get the index of a field in the list of handled fields
+ * @param[in]   field Query field
+ * @retval      Index of the field in m_fields
+ */
+int Reader::getFieldIndex(Fields field)
+{
+    if (field == m_field)
+        return 0;
+
+    checkFieldValidity(field);
+    return std::find(m_fields.begin(), m_fields.end(), field) - m_fields.begin();
+}
+
+/**
+ * @brief       Get the read values of a handled field, converted to SI units once per read
+ * @param[in]   field Query field
+ * @retval      Table of the field's last read values, same order as m_ids
+ */
+float* Reader::getFieldData(Fields field)
+{
+    int f = getFieldIndex(field);
+
+    if (m_decoded_seq[f] != m_nbr_reads) {
+        decodeField(f, getGatheredField(f), m_turn_offsets, m_dataPerField[f]);
+        m_decoded_seq[f] = m_nbr_reads;
+    }
+
+    return m_dataPerField[f];
+}
+
+/**
+ * @brief       Get the read values of a handled field as sent by the motors (eg position ticks)
+ * @param[in]   field Query field
+ * @retval      Table of the field's last read parametrized values, same order as m_ids
+ */
+const int32_t* Reader::getFieldRawData(Fields field)
+{
+    return getGatheredField(getFieldIndex(field));
+}
 
 /**
- * @brief       Convert position into angle based on motor model 
- * @param[in]   position Position to be converted
- * @param[in]   id ID of the motor
- * @param[in]   units Conversion units between the position and the angle
- * @return      Angle position [rad] of the query motor
+ * @brief       Get the read value of a handled field of a motor, as sent by the motor
+ * @param[in]   field Query field
+ * @param[in]   id Query motor
+ * @retval      Last read parametrized value
  */
-float Reader::position2Angle(int32_t position, int id, float units)
+int32_t Reader::getRawValue(Fields field, int id)
 {
-    float angle;
+    checkIDvalidity(std::span<const int>(&id, 1));
+
+    return getFieldRawData(field)[getMotorIndexFromID(id)];
+}
 
-    int motor_idx = m_hal.getMotorsListIndexFromID(id);
-    int model = m_hal.m_motors_list[motor_idx].scanned_model;
 
-    if (model == 1030 || model == 1000 || model == 310){
-    	int Model_max_position = 4095;
-        
-        angle = ((float) position - Model_max_position/2) * units;
+/*
+ *****************************************************************************
+ *                        Validity of the read data
+ ****************************************************************************/
+
+/**
+ * @brief       Enable re-reading the motors that did not reply, right after the failed read
+ * @param[in]   max_retries Maximal number of re-reads per read, 0 to disable them
+ * @param[in]   budget Time after the read's request during which a re-read can still be started
+ * @retval      void
+ */
+void Reader::setRetries(int max_retries, std::chrono::microseconds budget)
+{
+    if (max_retries < 0) {
+        cout << "[KMR::dxlP1::Reader] The number of retries cannot be negative!" << endl;
+        exit(1);
     }
-    else {
-        cout << "This model is unknown, cannot calculate angle from position!" << endl;
-        return (1);
+
+    m_max_retries = max_retries;
+    m_retry_budget = budget;
+}
+
+/**
+ * @brief       Check if the values of a motor come from the last read
+ * @param[in]   id Query motor
+ * @retval      bool: true if the motor replied to the last read including it
+ */
+bool Reader::isValid(int id)
+{
+    checkIDvalidity(std::span<const int>(&id, 1));
+
+    return m_received[getMotorIndexFromID(id)];
+}
+
+/**
+ * @brief       Get the validity of all handled motors' values
+ * @retval      Table holding 1 if the motor replied to the last read including it, same order as m_ids
+ */
+const uint8_t* Reader::getValidMask()
+{
+    return m_received;
+}
+
+/**
+ * @brief       Get the age of the values of a motor
+ * @param[in]   id Query motor
+ * @retval      Time [s] since the request of the motor's last valid reply, infinity if it never replied
+ */
+double Reader::getSampleAge(int id)
+{
+    checkIDvalidity(std::span<const int>(&id, 1));
+
+    const auto& stamp = m_sample_stamps[getMotorIndexFromID(id)];
+
+    if (stamp == std::chrono::steady_clock::time_point())
+        return std::numeric_limits<double>::infinity();
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - stamp).count();
+}
+
+
+/*
+ *****************************************************************************
+ *                            Published snapshots
+ ****************************************************************************/
+
+/**
+ * @brief       Publish the last read as a new snapshot, for the consumer thread
+ * @note        Called by the thread using the bus only. Never waits for the consumer
+ * @param[in]   ids List of motors of the read
+ * @retval      void
+ */
+void Reader::publishSnapshot(std::span<const int> ids)
+{
+    Read_snapshot& snapshot = m_snapshots[m_snapshot_back];
+    int nbr_motors = m_ids.size();
+
+    // Raw spans, and the first field already converted
+    std::memcpy(snapshot.raw, m_rawData, nbr_motors*m_data_byte_size);
+    std::memcpy(snapshot.data, m_dataFromMotor, nbr_motors*sizeof(float));
+    std::memset(snapshot.gathered, 0, m_fields.size());
+    std::memset(snapshot.decoded, 0, m_fields.size());
+    snapshot.decoded[0] = 1;
+
+    std::memset(snapshot.received, 0, nbr_motors);
+    for (int i=0; i<ids.size(); i++) {
+        int idx = m_slot_from_id[ids[i]];
+        snapshot.received[idx] = m_received[idx];
+    }
+    std::copy(m_sample_stamps, m_sample_stamps + nbr_motors, snapshot.sample_stamps);
+    std::copy(m_turn_offsets, m_turn_offsets + nbr_motors, snapshot.turn_offsets);
+
+    snapshot.seq = m_nbr_reads;
+    snapshot.stamp = m_request_stamp;
+
+    // Swap the filled snapshot with the middle one, flagged as fresh for the consumer
+    int previous = m_snapshot_middle.exchange(m_snapshot_back | SNAPSHOT_FRESH, std::memory_order_acq_rel);
+    m_snapshot_back = previous & SNAPSHOT_INDEX;
+}
+
+/**
+ * @brief       Get the latest read published by the bus thread
+ * @note        To be called by a single consumer thread. The returned snapshot stays 
+ *              unchanged until the next call
+ * @retval      Latest published snapshot, with seq = 0 if no read was done yet
+ */
+const Read_snapshot& Reader::latestSnapshot()
+{
+    if (m_snapshot_middle.load(std::memory_order_relaxed) & SNAPSHOT_FRESH) {
+        int previous = m_snapshot_middle.exchange(m_snapshot_front, std::memory_order_acq_rel);
+        m_snapshot_front = previous & SNAPSHOT_INDEX;
+    }
+
+    return m_snapshots[m_snapshot_front];
+}
+
+/**
+ * @brief       Get the values of a handled field in a published snapshot, converted to SI units
+ * @note        The conversion is done on the first access, by the consumer thread
+ * @param[in]   snapshot Snapshot returned by latestSnapshot
+ * @param[in]   field Query field
+ * @retval      Table of the field's values, same order as m_ids
+ */
+const float* Reader::getSnapshotFieldData(const Read_snapshot& snapshot, Fields field)
+{
+    int f = getFieldIndex(field);
+    float *data = snapshot.data + f*m_ids.size();
+
+    if (!snapshot.decoded[f]) {
+        decodeField(f, getSnapshotRawData(snapshot, field), snapshot.turn_offsets, data);
+        snapshot.decoded[f] = 1;
+    }
+
+    return data;
+}
+
+/**
+ * @brief       Get the values of a handled field in a published snapshot, as sent by the motors
+ * @note        The values are gathered on the first access, by the consumer thread
+ * @param[in]   snapshot Snapshot returned by latestSnapshot
+ * @param[in]   field Query field
+ * @retval      Table of the field's parametrized values, same order as m_ids
+ */
+const int32_t* Reader::getSnapshotRawData(const Read_snapshot& snapshot, Fields field)
+{
+    int f = getFieldIndex(field);
+    int32_t *params = snapshot.params + f*m_ids.size();
+
+    if (!snapshot.gathered[f]) {
+        gatherField(f, snapshot.raw, params);
+        snapshot.gathered[f] = 1;
     }
 
-    return angle;
+    return params;
 }
 
 }
\ No newline at end of file
@@ -12,6 +12,8 @@
  ******************************************************************************
  */
 
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <iostream>
 
@@ -22,6 +24,19 @@
 #define PROTOCOL_VERSION            1.0
 #define ENABLE                      1
 #define DISABLE                     0
+#define STATUS_RETURN_READ          1       // Status packets only for READ (and PING) instructions
+#define EEPROM_WRITE_US             10000   // Time for the motors to store EEPROM writes
+#define MAX_RESET_STEPS             100     // Steps after which a blocking multiturn reset gives up
+#define MAX_MODE_WRITES             3       // Attempts after which a mode switch gives up
+#define BAUDRATE_TOLERANCE          0.03    // Max. relative error between a baudrate and the motors' one
+
+static const int ENABLE_DATA[] = {ENABLE};
+static const int DISABLE_DATA[] = {DISABLE};
+static const int STATUS_RETURN_DATA[] = {STATUS_RETURN_READ};
+static const float RETURN_DELAY_DATA[] = {0};
+// Baudrates tried when looking for the motors, after the port's and the target ones
+static const int BUS_BAUDRATES[] = {1000000, 3000000, 2500000, 2250000, 57600, 115200, 
+                                    200000, 250000, 400000, 500000, 9600};
 
 
 using namespace std;
@@ -35,9 +50,9 @@ namespace KMR::dxlP1
  * @param[in]   all_ids List of IDs of all the motors in the robot
  * @param[in]   port_name Name of the port handling the communication with motors
  * @param[in]   baudrate Baudrate of the port handling communication with motors
- * @param[in]   hal Previously initialized Hal object
+ * @param[in]   hal Previously initialized Hal object, shared by all handlers
  */
-BaseRobot::BaseRobot(vector<int> all_ids, const char *port_name, int baudrate, Hal hal)
+BaseRobot::BaseRobot(vector<int> all_ids, const char *port_name, int baudrate, std::shared_ptr<Hal> hal)
 {
     m_hal = hal;
     m_all_IDs = all_ids;
@@ -45,15 +60,39 @@ BaseRobot::BaseRobot(vector<int> all_ids, const char *port_name, int baudrate, H
     // Connect U2D2
     init_comm(port_name, baudrate, PROTOCOL_VERSION);
 
+    // Move the motors to the bus baudrate of the config file, if not there yet
+    if (m_hal->m_bus_baudrate != 0 && !migrateBaudrate(m_hal->m_bus_baudrate))
+        cout << "Keeping the motors' baudrate" << endl;
+
     // 2 integrated handlers: motor enabling and mode setter
-    m_motor_enabler = new Writer(TRQ_ENABLE, m_all_IDs, portHandler_, packetHandler_, m_hal);
-    m_CW_limit = new Writer(CW_ANGLE_LIMIT, m_all_IDs, portHandler_, packetHandler_, m_hal);
-    m_CCW_limit = new Writer(CCW_ANGLE_LIMIT, m_all_IDs, portHandler_, packetHandler_, m_hal);
-    m_torque_control = new Writer(TRQ_MODE_ENABLE, m_all_IDs, portHandler_, packetHandler_, m_hal);
+    m_motor_enabler = new FieldWriter<TRQ_ENABLE>(m_all_IDs, portHandler_, packetHandler_, m_hal);
+    m_CW_limit = new FieldWriter<CW_ANGLE_LIMIT>(m_all_IDs, portHandler_, packetHandler_, m_hal);
+    m_CCW_limit = new FieldWriter<CCW_ANGLE_LIMIT>(m_all_IDs, portHandler_, packetHandler_, m_hal);
+    m_status_return_writer = new FieldWriter<STATUS_RETURN>(m_all_IDs, portHandler_, packetHandler_, m_hal);
+    m_return_delay_writer = new FieldWriter<RETURN_DELAY>(m_all_IDs, portHandler_, packetHandler_, m_hal);
+    m_status_reader = new Reader({RETURN_DELAY, STATUS_RETURN}, m_all_IDs, portHandler_, packetHandler_, m_hal);
+    m_enabler_all_ids = m_motor_enabler->prepareIDs(m_all_IDs);
+    m_batcher = new Batcher(portHandler_, packetHandler_);
+    m_reset_reader = new Reader({CW_ANGLE_LIMIT, CCW_ANGLE_LIMIT, TRQ_ENABLE, PRESENT_POS}, m_all_IDs, portHandler_, packetHandler_, m_hal);
+    m_reset_ids = new int[m_hal->m_tot_nbr_motors];
+    m_mode_ids = new int[m_hal->m_tot_nbr_motors];
+    m_mode_limits = new float[m_hal->m_tot_nbr_motors];
+    m_enable_ids = new int[m_hal->m_tot_nbr_motors];
+
+    // Configuration writes: only the changed registers, with a broadcast write if all motors get the same value
+    m_motor_enabler->enableBroadcast();
+    m_CW_limit->enableBroadcast();
+    m_CCW_limit->enableBroadcast();
+    m_status_return_writer->enableBroadcast();
+    m_return_delay_writer->enableBroadcast();
+    invalidateConfigMirror();
 
     // Ping each motor to validate the communication is working
     check_comm();
 
+    // Status packets only for reads, sent without delay
+    configureStatusReturn();
+
 }
 
 
@@ -94,7 +133,8 @@ void BaseRobot::init_comm(const char *port_name, int baudrate, float protocol_ve
 }
 
 /**
- * @brief       Ping each motor to validate the communication is working
+ * @brief       Ping each motor to validate the communication is working. \n 
+ *              After a warm start, a single bulk read of the model numbers is tried first
  * @retval      void
  */
 void BaseRobot::check_comm()
@@ -102,9 +142,11 @@ void BaseRobot::check_comm()
     bool result = false;
     uint16_t model_number = 0;
     uint8_t dxl_error = 0;
-    int motor_idx;
     int id = 0;
 
+    if (m_hal->isWarmStarted() && check_comm_warm())
+        return;
+
     cout << "Pinging motors...." << endl;
 
     for (int i=0; i<m_all_IDs.size(); i++) {
@@ -117,12 +159,329 @@ void BaseRobot::check_comm()
         }
         else {
             cout << "id: " << id << ", model number : " << model_number << endl;
-            motor_idx = m_hal.getMotorsListIndexFromID(id);
-            m_hal.m_motors_list[motor_idx].scanned_model = model_number; 
+            m_hal->updateScannedModel(id, model_number);
+
+            if (modelFromModelNumber(model_number) == UNDEF_M) {
+                cout << "Motor " << id << " has model number " << model_number << ", which matches no motor model "
+                     << "file: add its model file to config/motor_models (protocol 2 motors are handled by KMR_dxlP2)!" << endl;
+                exit(1);
+            }
+            else if (modelFromModelNumber(model_number) != m_hal->getMotorFromID(id).model) {
+                cout << "Motor " << id << " is not a " << MOTOR_MODEL_NAMES[m_hal->getMotorFromID(id).model]
+                     << " as declared in the config file!" << endl;
+                exit(1);
+            }
+        }
+    }
+
+    // Save the scanned models for the next warm start
+    m_hal->saveSnapshot();
+}
+
+/**
+ * @brief       Read the model number of all motors in one bus transaction (bulk read)
+ * @param[out]  model_numbers Read model number of each motor, same order as m_all_IDs
+ * @retval      bool: true if every motor answered
+ */
+bool BaseRobot::readModelNumbers(vector<int>& model_numbers)
+{
+    dynamixel::GroupBulkRead model_reader(portHandler_, packetHandler_);
+    Motor_data_field model_nbr;
+    int id;
+
+    for (int i=0; i<m_all_IDs.size(); i++) {
+        model_nbr = m_hal->getControlParametersFromID(m_all_IDs[i], MODEL_NBR);
+        if (!model_reader.addParam(m_all_IDs[i], model_nbr.address, model_nbr.length))
+            return false;
+    }
+
+    if (model_reader.txRxPacket() != COMM_SUCCESS)
+        return false;
+
+    model_numbers = vector<int>(m_all_IDs.size());
+    for (int i=0; i<m_all_IDs.size(); i++) {
+        id = m_all_IDs[i];
+        model_nbr = m_hal->getControlParametersFromID(id, MODEL_NBR);
+
+        if (!model_reader.isAvailable(id, model_nbr.address, model_nbr.length))
+            return false;
+        model_numbers[i] = model_reader.getData(id, model_nbr.address, model_nbr.length);
+    }
+
+    return true;
+}
+
+/**
+ * @brief       Confirm a warm start in one bus transaction: bulk read the model number of all
+ *              motors and compare them to the ones saved in the snapshot
+ * @retval      bool: true if every motor answered with its saved model number
+ */
+bool BaseRobot::check_comm_warm()
+{
+    vector<int> model_numbers;
+    int idx;
+
+    if (!readModelNumbers(model_numbers)) {
+        cout << "Warm start: motors did not answer, pinging them one by one" << endl;
+        return false;
+    }
+
+    for (int i=0; i<m_all_IDs.size(); i++) {
+        idx = m_hal->getMotorsListIndexFromID(m_all_IDs[i]);
+
+        if (model_numbers[i] != m_hal->m_scanned_models[idx]) {
+            cout << "Warm start: motor " << m_all_IDs[i] << " changed, pinging all motors" << endl;
+            return false;
+        }
+    }
+
+    cout << "Warm start: all motors confirmed" << endl;
+    return true;
+}
+
+/**
+ * @brief       Set all motors to reply to reads only (no status packet after writes), without 
+ *              return delay. \n 
+ *              Both registers are read back in one bulk read, and only the motors with other 
+ *              values are written. The readers' timeouts are then sized for the configured delay
+ * @note        The registers are in EEPROM: once configured, the next startups only read them
+ * @retval      void
+ */
+void BaseRobot::configureStatusReturn()
+{
+    vector<int> to_configure;
+    int id;
+
+    m_status_reader->syncRead(m_all_IDs);
+    for (int i=0; i<m_all_IDs.size(); i++) {
+        id = m_all_IDs[i];
+        if (!m_status_reader->isValid(id) ||
+            m_status_reader->getRawValue(STATUS_RETURN, id) != STATUS_RETURN_READ ||
+            m_status_reader->getRawValue(RETURN_DELAY, id) != 0)
+            to_configure.push_back(id);
+    }
+
+    if (!to_configure.empty()) {
+        cout << "Configuring the status return of " << to_configure.size() << " motor(s)" << endl;
+
+        vector<int> status_return(to_configure.size(), STATUS_RETURN_DATA[0]);
+        vector<float> return_delay(to_configure.size(), RETURN_DELAY_DATA[0]);
+        m_status_return_writer->addDataToWrite(status_return, to_configure);
+        m_status_return_writer->syncWrite(to_configure);
+        m_return_delay_writer->addDataToWrite(return_delay, to_configure);
+        m_return_delay_writer->syncWrite(to_configure);
+        usleep(EEPROM_WRITE_US);
+
+        // Writes get no status packet: confirm with a new read
+        m_status_reader->syncRead(m_all_IDs);
+    }
+
+    // Largest return delay on the bus, used by the readers' timeouts
+    float max_return_delay = 0;
+    for (int i=0; i<m_all_IDs.size(); i++) {
+        id = m_all_IDs[i];
+        if (!m_status_reader->isValid(id) || 
+            m_status_reader->getRawValue(STATUS_RETURN, id) != STATUS_RETURN_READ) {
+            cout << "Failed to configure the status return of motor " << id 
+                 << ", keeping the default reply timeouts" << endl;
+            return;
         }
+        max_return_delay = std::max(max_return_delay, 
+            m_status_reader->getRawValue(RETURN_DELAY, id) * m_hal->getControlParametersFromID(id, RETURN_DELAY).unit);
     }
+
+    m_hal->updateStatusReturn(STATUS_RETURN_READ, max_return_delay);
 }
 
+
+/*
+******************************************************************************
+ *                              Bus baudrate
+ ****************************************************************************/
+
+/**
+ * @brief       Get the BAUDRATE register value selecting a baudrate (protocol 1 MX and AX motors)
+ * @param[in]   baudrate Query baudrate [bps]
+ * @retval      Register value, -1 if the motors cannot use this baudrate
+ */
+static int baudrateRegister(int baudrate)
+{
+    if (baudrate == 2250000)
+        return 250;
+    else if (baudrate == 2500000)
+        return 251;
+    else if (baudrate == 3000000)
+        return 252;
+    else if (baudrate <= 0)
+        return -1;
+
+    // Other baudrates: 2 Mbps / (value + 1)
+    int value = (int) std::lround(2000000.0 / baudrate) - 1;
+    if (value < 0 || value > 249)
+        return -1;
+
+    float error = std::fabs(2000000.0f / (value + 1) - baudrate) / baudrate;
+    return (error <= BAUDRATE_TOLERANCE) ? value : -1;
+}
+
+/**
+ * @brief       Ping, at a given baudrate, the motors not located yet
+ * @param[in]   baudrate Baudrate at which the motors are pinged
+ * @param[in/out] motor_rates Baudrate of each motor (same order as m_all_IDs), 0 if not located yet. 
+ *              The motors replying get the input baudrate
+ * @retval      Number of motors located at this baudrate
+ */
+int BaseRobot::locateMotors(int baudrate, vector<int>& motor_rates)
+{
+    uint16_t model_number = 0;
+    uint8_t dxl_error = 0;
+    int nbr_located = 0;
+
+    if (!portHandler_->setBaudRate(baudrate))
+        return 0;
+
+    for (int i=0; i<m_all_IDs.size(); i++) {
+        if (motor_rates[i] != 0)
+            continue;
+        if (packetHandler_->ping(portHandler_, m_all_IDs[i], &model_number, &dxl_error) == COMM_SUCCESS) {
+            motor_rates[i] = baudrate;
+            nbr_located++;
+        }
+    }
+
+    return nbr_located;
+}
+
+/**
+ * @brief       Write the BAUDRATE register of the motors found at a given bus baudrate. \n 
+ *              Writes get no status packet: the motors are to be pinged at the new baudrate
+ * @param[in]   motor_rates Baudrate of each motor (same order as m_all_IDs)
+ * @param[in]   bus_rate Baudrate of the motors to be written, at which the port is set
+ * @param[in]   baudrate New baudrate of the written motors
+ * @retval      void
+ */
+void BaseRobot::writeBaudrate(const vector<int>& motor_rates, int bus_rate, int baudrate)
+{
+    Motor_data_field baudrate_field;
+
+    portHandler_->setBaudRate(bus_rate);
+
+    for (int i=0; i<m_all_IDs.size(); i++) {
+        if (motor_rates[i] != bus_rate)
+            continue;
+        baudrate_field = m_hal->getControlParametersFromID(m_all_IDs[i], BAUDRATE);
+        packetHandler_->write1ByteTxOnly(portHandler_, m_all_IDs[i], baudrate_field.address, baudrateRegister(baudrate));
+    }
+
+    usleep(EEPROM_WRITE_US);
+}
+
+/**
+ * @brief       Move all motors and the port to a new baudrate. \n 
+ *              If all motors reply to a bulk read at the new baudrate, nothing else is done. 
+ *              Otherwise, the motors are located one by one: at the new baudrate, at the port's one, 
+ *              then at the usual ones. The located motors get their BAUDRATE register written, and are all 
+ *              pinged at the new baudrate. \n 
+ *              If one does not reply, the motors that moved are written back their former 
+ *              baudrate, and the port is set back to the baudrate of most motors
+ * @note        Called by the constructor with the baudrate of the config file. 
+ *              Motors already at the new baudrate are not written
+ * @param[in]   baudrate New baudrate [bps], eg 1000000, 2250000, 2500000, 3000000
+ * @retval      bool: true if all motors reply at the new baudrate
+ */
+bool BaseRobot::migrateBaudrate(int baudrate)
+{
+    int port_rate = portHandler_->getBaudRate();
+    int nbr_motors = m_all_IDs.size();
+    vector<int> motor_rates(nbr_motors, 0), verified_rates(nbr_motors, 0);
+    int nbr_located = 0;
+
+    if (baudrateRegister(baudrate) < 0 || !portHandler_->setBaudRate(baudrate)) {
+        cout << "Baudrate " << baudrate << " is not supported by the motors or the port!" << endl;
+        portHandler_->setBaudRate(port_rate);
+        return false;
+    }
+
+    // Usual case, all motors already at the new baudrate: confirmed with a single bulk read
+    vector<int> model_numbers;
+    if (readModelNumbers(model_numbers))
+        return true;
+
+    // Locate the motors one by one, starting with the most likely baudrates
+    vector<int> candidates = {baudrate, port_rate};
+    candidates.insert(candidates.end(), std::begin(BUS_BAUDRATES), std::end(BUS_BAUDRATES));
+
+    for (int i=0; i<candidates.size() && nbr_located < nbr_motors; i++) {
+        if (std::find(candidates.begin(), candidates.begin()+i, candidates[i]) == candidates.begin()+i)
+            nbr_located += locateMotors(candidates[i], motor_rates);
+    }
+
+    if (nbr_located < nbr_motors) {
+        for (int i=0; i<nbr_motors; i++) {
+            if (motor_rates[i] == 0)
+                cout << "Motor " << m_all_IDs[i] << " not found at any baudrate" << endl;
+        }
+        portHandler_->setBaudRate(port_rate);
+        return false;
+    }
+
+    if (std::count(motor_rates.begin(), motor_rates.end(), baudrate) == nbr_motors)
+        return true;
+
+    // Move the motors, one former baudrate at a time, then check them all at the new one
+    cout << "Moving the motors to " << baudrate << " bps" << endl;
+    for (int i=0; i<nbr_motors; i++) {
+        if (motor_rates[i] != baudrate && std::find(motor_rates.begin(), motor_rates.begin()+i, motor_rates[i]) == motor_rates.begin()+i)
+            writeBaudrate(motor_rates, motor_rates[i], baudrate);
+    }
+
+    if (locateMotors(baudrate, verified_rates) == nbr_motors) {
+        cout << "Succeeded to move the motors to " << baudrate << " bps" << endl;
+        return true;
+    }
+
+    // Roll back the motors that moved
+    for (int i=0; i<nbr_motors; i++) {
+        if (verified_rates[i] == 0)
+            cout << "Motor " << m_all_IDs[i] << " does not reply at " << baudrate << " bps, rolling back" << endl;
+    }
+
+    for (int i=0; i<nbr_motors; i++) {
+        if (motor_rates[i] == baudrate || std::find(motor_rates.begin(), motor_rates.begin()+i, motor_rates[i]) != motor_rates.begin()+i)
+            continue;
+
+        vector<int> moved_rates(nbr_motors, 0);
+        for (int j=0; j<nbr_motors; j++) {
+            if (motor_rates[j] == motor_rates[i] && verified_rates[j] == baudrate)
+                moved_rates[j] = baudrate;
+        }
+        writeBaudrate(moved_rates, baudrate, motor_rates[i]);
+    }
+
+    // Check the rolled back motors at their former baudrates
+    vector<int> restored_rates(nbr_motors, 0);
+    for (int i=0; i<nbr_motors; i++) {
+        if (std::find(motor_rates.begin(), motor_rates.begin()+i, motor_rates[i]) == motor_rates.begin()+i)
+            locateMotors(motor_rates[i], restored_rates);
+    }
+    for (int i=0; i<nbr_motors; i++) {
+        if (restored_rates[i] != motor_rates[i])
+            cout << "Motor " << m_all_IDs[i] << " does not reply at its former baudrate " << motor_rates[i] << " bps!" << endl;
+    }
+
+    // Back to the baudrate of most motors
+    int bus_rate = motor_rates[0];
+    for (int i=1; i<nbr_motors; i++) {
+        if (std::count(motor_rates.begin(), motor_rates.end(), motor_rates[i]) > 
+            std::count(motor_rates.begin(), motor_rates.end(), bus_rate))
+            bus_rate = motor_rates[i];
+    }
+    portHandler_->setBaudRate(bus_rate);
+
+    return false;
+}
+
+
 /*
 ******************************************************************************
  *                         Enable/disable motors
@@ -134,8 +493,8 @@ void BaseRobot::check_comm()
  */
 void BaseRobot::enableMotors()
 {
-    m_motor_enabler->addDataToWrite(vector<int>{ENABLE}, m_all_IDs);
-    m_motor_enabler->syncWrite(m_all_IDs);
+    m_motor_enabler->addDataToWrite(ENABLE_DATA, m_enabler_all_ids);
+    m_motor_enabler->syncWrite(m_enabler_all_ids);
 }
 
 /**
@@ -143,9 +502,9 @@ void BaseRobot::enableMotors()
  * @param[in]   ids List of motor ids to be enabled
  * @retval      void
  */
-void BaseRobot::enableMotors(vector<int> ids)
+void BaseRobot::enableMotors(std::span<const int> ids)
 {
-    m_motor_enabler->addDataToWrite(vector<int>{ENABLE}, ids);
+    m_motor_enabler->addDataToWrite(ENABLE_DATA, ids);
     m_motor_enabler->syncWrite(ids);    
 }
 
@@ -155,8 +514,8 @@ void BaseRobot::enableMotors(vector<int> ids)
  */
 void BaseRobot::disableMotors()
 {
-    m_motor_enabler->addDataToWrite(vector<int>{DISABLE}, m_all_IDs);
-    m_motor_enabler->syncWrite(m_all_IDs);
+    m_motor_enabler->addDataToWrite(DISABLE_DATA, m_enabler_all_ids);
+    m_motor_enabler->syncWrite(m_enabler_all_ids);
 }
 
 /**
@@ -164,118 +523,293 @@ void BaseRobot::disableMotors()
  * @param[in]   ids List of motor ids to be disabled
  * @retval      void
  */
-void BaseRobot::disableMotors(vector<int> ids)
+void BaseRobot::disableMotors(std::span<const int> ids)
 {
-    m_motor_enabler->addDataToWrite(vector<int>{DISABLE}, ids);
+    m_motor_enabler->addDataToWrite(DISABLE_DATA, ids);
     m_motor_enabler->syncWrite(ids);    
 }
 
 
+/**
+ * @brief       Forget the configuration registers' values last written by the robot, so that the next 
+ *              configuration writes are all sent. \n 
+ *              To be called if the motors may have changed them on their own (eg torque disabled 
+ *              by an overload error, motor rebooted)
+ * @retval      void
+ */
+void BaseRobot::invalidateConfigMirror()
+{
+    m_motor_enabler->setDeltaSuppression(0, 0);
+    m_CW_limit->setDeltaSuppression(0, 0);
+    m_CCW_limit->setDeltaSuppression(0, 0);
+}
+
+
 /*
 ******************************************************************************
  *                Reset necessary motors in multiturn mode
  ****************************************************************************/
+
 /**
- * @brief       Set single motor to multiturn mode. Used for multiturn reset
- * @param[in]   id Motor id to get set to multiturn mode
- * @retval      void
+ * @brief       Get the CW angle limit selecting joint or multiturn mode for a motor
+ * @param[in]   motor_idx Index of the motor in the Hal's motors list
+ * @param[in]   joint_mode True for joint mode, false for multiturn mode
+ * @retval      CW angle limit, parametrized
+ */
+int BaseRobot::getResetLimit(int motor_idx, bool joint_mode)
+{
+    const Position_codec& codec = m_hal->positionCodec(m_hal->m_motor_models[motor_idx]);
+    return joint_mode ? codec.min_position : codec.max_position;
+}
+
+/**
+ * @brief       Check, from the last read back, that a motor applied the writes of its reset step
+ * @param[in]   motor_idx Index of the motor in the Hal's motors list
+ * @param[in]   joint_mode True if the motor should be in joint mode, false if in multiturn mode
+ * @param[in]   torque Expected torque enable
+ * @retval      bool: true if the motor replied with the expected values
  */
-void BaseRobot::setMultiturnControl_singleMotor(int id)
+bool BaseRobot::isResetStepDone(int motor_idx, bool joint_mode, int torque)
 {
-    m_CW_limit->addDataToWrite(vector<float>{0}, vector<int>{id});
-    m_CW_limit->syncWrite(vector<int>{id});
+    int id = m_hal->m_motor_ids[motor_idx];
+
+    return m_reset_reader->isValid(id) &&
+           m_reset_reader->getRawValue(TRQ_ENABLE, id) == torque &&
+           m_reset_reader->getRawValue(CW_ANGLE_LIMIT, id) == getResetLimit(motor_idx, joint_mode);
 }
 
 /**
- * @brief       Set single motor to position control mode. Used for multiturn reset
- * @param[in]   id Motor id to get set to control position mode
+ * @brief       Advance the multiturn reset of the flagged motors by one step. To be called once 
+ *              per control cycle, the reset of a motor taking 5 cycles: \n 
+ *              disable + joint mode, enable, disable + multiturn mode, enable, done. \n 
+ *              Each step is confirmed by reading the motors back at the next call, and sent 
+ *              again if it was not applied. Only the motors being reset are dis/enabled. \n 
+ *              The read back positions keep the motors' turn offsets up to date, so that the 
+ *              continuous positions are unchanged by the reset
  * @retval      void
+ * @note        The port must be free: collect pending reads before calling this function. \n 
+ *              Make sure the motors had enough time to execute the goal position command before 
+ *              they get flagged. Failure to do so results in undefined behavior.
  */
-void BaseRobot::setPositionControl_singleMotor(int id)
+void BaseRobot::resetMultiturnMotors()
 {
-    m_CW_limit->addDataToWrite(vector<float>{0}, vector<int>{id});
-    m_CW_limit->syncWrite(vector<int>{id});
+    const int* ids = m_hal->m_motor_ids;
+    int nbr_motors = m_hal->m_tot_nbr_motors;
+    int nbr_confirm = 0, nbr_mode = 0, nbr_enable = 0;
+    bool resend = false;
+    int step, next_step;
+
+    // Read back the motors whose last step needs a confirmation
+    for (int i=0; i<nbr_motors; i++) {
+        if (m_hal->resetStatusAt(i) > RESET_FLAGGED)
+            m_reset_ids[nbr_confirm++] = ids[i];
+    }
+    if (nbr_confirm > 0)
+        m_reset_reader->syncRead(std::span<const int>(m_reset_ids, nbr_confirm));
+
+    for (int i=0; i<nbr_motors; i++) {
+        step = m_hal->resetStatusAt(i);
+        next_step = step;
+
+        switch (step) {
+            case RESET_IDLE:
+                continue;
+            case RESET_FLAGGED:
+                next_step = RESET_TO_JOINT;
+                break;
+            case RESET_TO_JOINT:
+                if (isResetStepDone(i, true, DISABLE))
+                    next_step = RESET_JOINT_ENABLED;
+                break;
+            case RESET_JOINT_ENABLED:
+                if (isResetStepDone(i, true, ENABLE))
+                    next_step = RESET_TO_MULTITURN;
+                break;
+            case RESET_TO_MULTITURN:
+                if (isResetStepDone(i, false, DISABLE))
+                    next_step = RESET_MULTITURN_ENABLED;
+                break;
+            case RESET_MULTITURN_ENABLED:
+                if (isResetStepDone(i, false, ENABLE))
+                    next_step = RESET_IDLE;
+                break;
+        }
+
+        if (next_step == step)
+            resend = true;
+        m_hal->updateResetStatusAt(i, next_step);
+
+        // Writes of the step, confirmed at the next call
+        if (next_step == RESET_TO_JOINT || next_step == RESET_TO_MULTITURN) {
+            const Position_codec& codec = m_hal->positionCodec(m_hal->m_motor_models[i]);
+            float unit = m_hal->controlParameters(m_hal->m_motor_models[i], CW_ANGLE_LIMIT).unit;
+            int limit = getResetLimit(i, next_step == RESET_TO_JOINT);
+
+            m_mode_ids[nbr_mode] = ids[i];
+            m_mode_limits[nbr_mode++] = (limit - codec.center) * unit;
+        }
+        else if (next_step == RESET_JOINT_ENABLED || next_step == RESET_MULTITURN_ENABLED)
+            m_enable_ids[nbr_enable++] = ids[i];
+    }
+
+    // A step not applied is sent again, whatever the registers last written by the robot
+    if (resend)
+        invalidateConfigMirror();
+
+    // Need to enable the motors with the new control type for it to register
+    if (nbr_mode > 0) {
+        std::span<const int> mode_ids(m_mode_ids, nbr_mode);
+        disableMotors(mode_ids);
+        m_CW_limit->addDataToWrite(std::span<const float>(m_mode_limits, nbr_mode), mode_ids);
+        m_CW_limit->syncWrite(mode_ids);
+    }
+    if (nbr_enable > 0)
+        enableMotors(std::span<const int>(m_enable_ids, nbr_enable));
 }
 
 
 /**
- * @brief       Set single motor to torque control mode. Used for multiturn reset
- * @param[in]   id Motor id to get set to multiturn mode
- * @param[in]   on_off 1/0 for enable/disable torque control mode
+ * @brief       Reset the flagged multiturn motors at once, waiting the input sleeping time 
+ *              between the reset steps
+ * @param[in]   sleep_time_us Sleep time in microseconds between two steps
  * @retval      void
+ * @note        Blocks until the reset is done: in a control loop, call resetMultiturnMotors() 
+ *              once per cycle instead.
  */
-void BaseRobot::setTorqueControl_singleMotor(int id, int on_off)
+void BaseRobot::resetMultiturnMotors(int sleep_time_us)
 {
-    m_torque_control->addDataToWrite(vector<int>{on_off}, vector<int>{id});
-    m_torque_control->syncWrite(vector<int>{id});
+    for (int i=0; isResettingMultiturn(); i++) {
+        if (i == MAX_RESET_STEPS) {
+            cout << "Multiturn reset not confirmed by the motors, giving up" << endl;
+            return;
+        }
+        resetMultiturnMotors();
+        usleep(sleep_time_us);
+    }
 }
 
 
+/*
+******************************************************************************
+ *                      Switch motors to/from wheel mode
+ ****************************************************************************/
+
+/**
+ * @brief       Get the angle limits selecting a motor's mode
+ * @param[in]   motor_idx Index of the motor in the Hal's motors list
+ * @param[in]   wheel_mode True for wheel mode, false for the motor's position mode (joint or multiturn)
+ * @param[in]   cw True for the CW angle limit, false for the CCW angle limit
+ * @retval      Angle limit, parametrized
+ */
+int BaseRobot::getModeLimit(int motor_idx, bool wheel_mode, bool cw)
+{
+    const Position_codec& codec = m_hal->positionCodec(m_hal->m_motor_models[motor_idx]);
+
+    if (wheel_mode)
+        return codec.min_position;
+    else if (cw)
+        return getResetLimit(motor_idx, !m_hal->m_multiturn[motor_idx]);
+    else
+        return codec.max_position;
+}
+
 /**
- * @brief       Reset multiturn motors flagged as needing a reset, with input sleeping time.
- * @param[in]   sleep_time_us Sleep time in microseconds after dis/enabling motors
+ * @brief       Switch motors to wheel mode or back to their position mode, enabled in the new mode. \n 
+ *              The motors are read back, and written again if they did not apply the mode
+ * @param[in]   ids List of motors to be switched
+ * @param[in]   wheel_mode True for wheel mode, false for the motors' position mode
  * @retval      void
- * @note        Make sure the motors had enough time to execute the goal position command before 
- *              calling this function. Failure to do so results in undefined behavior.
  */
-void BaseRobot::resetMultiturnMotors(int sleep_time_us)
+void BaseRobot::switchMode(std::span<const int> ids, bool wheel_mode)
 {
-    Motor motor;
-    int id;
-    int reset_flag = 0;
+    vector<int> to_switch(ids.begin(), ids.end());
+    vector<int> failed;
+    int motor_idx;
 
-    for(int i=0; i<m_all_IDs.size(); i++) {
-        id = m_all_IDs[i];
-        motor = m_hal.getMotorFromID(id);
-        if (motor.toReset) {
-            reset_flag = 1;
-            break;
+    // A motor changing mode is not reset anymore
+    for (int i=0; i<to_switch.size(); i++)
+        m_hal->updateResetStatusAt(m_hal->getMotorsListIndexFromID(to_switch[i]), RESET_IDLE);
+
+    for (int attempt=0; !to_switch.empty(); attempt++) {
+        if (attempt == MAX_MODE_WRITES) {
+            cout << "Mode switch not confirmed by " << to_switch.size() << " motor(s), giving up" << endl;
+            return;
         }
-    }
 
-    if (reset_flag == 1 || reset_flag == 2) {
-        disableMotors();
+        vector<float> cw_limits(to_switch.size()), ccw_limits(to_switch.size());
+        for (int i=0; i<to_switch.size(); i++) {
+            motor_idx = m_hal->getMotorsListIndexFromID(to_switch[i]);
+            const Position_codec& codec = m_hal->positionCodec(m_hal->m_motor_models[motor_idx]);
+            float unit = m_hal->controlParameters(m_hal->m_motor_models[motor_idx], CW_ANGLE_LIMIT).unit;
 
-        for(int i=0; i<m_all_IDs.size(); i++) {
-            id = m_all_IDs[i];
-            motor = m_hal.getMotorFromID(id);
-            if (motor.toReset == 1) {
-                setPositionControl_singleMotor(id);
-                m_hal.updateResetStatus(id, 2);
-            }
+            cw_limits[i] = (getModeLimit(motor_idx, wheel_mode, true) - codec.center) * unit;
+            ccw_limits[i] = (getModeLimit(motor_idx, wheel_mode, false) - codec.center) * unit;
         }
 
-        // Need to enable the motors with the new control type for it to register
-        usleep(sleep_time_us);
-        enableMotors();
-        usleep(sleep_time_us);
-        disableMotors();
-
-        for(int i=0; i<m_all_IDs.size(); i++) {
-            id = m_all_IDs[i];
-            motor = m_hal.getMotorFromID(id);
-            if (motor.toReset == 2) {
-                setMultiturnControl_singleMotor(id);
-                m_hal.updateResetStatus(id, 0);
-            }
+        disableMotors(to_switch);
+        m_CW_limit->addDataToWrite(cw_limits, to_switch);
+        m_CW_limit->syncWrite(to_switch);
+        m_CCW_limit->addDataToWrite(ccw_limits, to_switch);
+        m_CCW_limit->syncWrite(to_switch);
+        usleep(EEPROM_WRITE_US);
+        enableMotors(to_switch);
+
+        // Writes get no status packet: confirm with a read
+        m_reset_reader->syncRead(to_switch);
+        failed.clear();
+        for (int i=0; i<to_switch.size(); i++) {
+            motor_idx = m_hal->getMotorsListIndexFromID(to_switch[i]);
+            if (!m_reset_reader->isValid(to_switch[i]) ||
+                m_reset_reader->getRawValue(TRQ_ENABLE, to_switch[i]) != ENABLE ||
+                m_reset_reader->getRawValue(CW_ANGLE_LIMIT, to_switch[i]) != getModeLimit(motor_idx, wheel_mode, true) ||
+                m_reset_reader->getRawValue(CCW_ANGLE_LIMIT, to_switch[i]) != getModeLimit(motor_idx, wheel_mode, false))
+                failed.push_back(to_switch[i]);
         }
-        usleep(sleep_time_us);
-        enableMotors();
-        usleep(sleep_time_us);
+
+        if (!failed.empty())
+            invalidateConfigMirror();
+        to_switch = failed;
     }
 }
 
+/**
+ * @brief       Switch motors to wheel mode (CW and CCW angle limits at 0), to be driven in speed 
+ *              (eg. by a WheelDrive), and enable them
+ * @param[in]   ids List of motors to be switched to wheel mode
+ * @retval      void
+ * @note        The motors start turning at their MOVING_SPEED: set it to 0 beforehand (WheelDrive::stop). \n 
+ *              A multiturn reset in progress on these motors is cancelled
+ */
+void BaseRobot::setWheelMode(std::span<const int> ids)
+{
+    switchMode(ids, true);
+}
 
 /**
- * @brief       Reset multiturn motors flagged as needing a reset, using the default 1ms sleep time. \n 
- *              Use the overloaded function to set a custom value as argument
+ * @brief       Switch motors back to their position mode, multiturn or joint as in the configuration 
+ *              file, and enable them
+ * @param[in]   ids List of motors to be switched to position mode
  * @retval      void
- * @note        Make sure the motors had enough time to execute the goal position command before 
- *              calling this function. Failure to do so results in undefined behavior.
+ * @note        The motors move to their GOAL_POS at once: set it to the present position beforehand 
+ *              (WheelDrive::hold)
  */
-void BaseRobot::resetMultiturnMotors()
+void BaseRobot::setPositionMode(std::span<const int> ids)
 {
-    resetMultiturnMotors(1000);
+    switchMode(ids, false);
+}
+
+
+/**
+ * @brief       Check if some motors are flagged for, or going through, a multiturn reset
+ * @retval      bool: true if a multiturn reset is in progress
+ */
+bool BaseRobot::isResettingMultiturn()
+{
+    for (int i=0; i<m_hal->m_tot_nbr_motors; i++) {
+        if (m_hal->resetStatusAt(i) != RESET_IDLE)
+            return true;
+    }
+    return false;
 }
 
 
@@ -0,0 +1,171 @@
+/**
+ ******************************************************************************
+ * @file            KMR_dxlP1_wheel_drive.cpp
+ * @brief           Defines the WheelDrive class
+ ******************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ ******************************************************************************
+ */
+
+#include "KMR_dxlP1_wheel_drive.hpp"
+
+static const float STOP_DATA[] = {0};
+
+
+using std::cout;
+using std::endl;
+
+
+namespace KMR::dxlP1
+{
+
+/**
+ * @brief       Constructor for a WheelDrive
+ * @param[in]   ids Motors to be driven in wheel mode, declared multiturn in the configuration file
+ * @param[in]   portHandler Object handling port communication
+ * @param[in]   packetHandler Object handling packets
+ * @param[in]   hal Previously initialized Hal object, shared by all handlers
+ */
+WheelDrive::WheelDrive(std::vector<int> ids, dynamixel::PortHandler *portHandler,
+                       dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal)
+: m_ids(ids),
+  m_speed_writer(ids, portHandler, packetHandler, hal),
+  m_goal_writer(ids, portHandler, packetHandler, hal),
+  m_position_reader(ids, portHandler, packetHandler, hal),
+  m_batcher(portHandler, packetHandler)
+{
+    // Continuous angles are only tracked for multiturn motors
+    for (int i=0; i<m_ids.size(); i++) {
+        if (!hal->m_multiturn[hal->getMotorsListIndexFromID(m_ids[i])]) {
+            cout << "[KMR::dxlP1::WheelDrive] Motor " << m_ids[i]
+                 << " needs to be declared multiturn to be driven in wheel mode!" << endl;
+            exit(1);
+        }
+    }
+
+    m_speeds = new float[m_ids.size()];
+    m_corrections = new float[m_ids.size()]();
+}
+
+/**
+ * @brief Destructor
+ */
+WheelDrive::~WheelDrive()
+{
+    delete[] m_speeds;
+    delete[] m_corrections;
+}
+
+
+/*
+ *****************************************************************************
+ *                               Control cycle
+ ****************************************************************************/
+
+/**
+ * @brief       Set the phase loop: speed correction per phase error, and position read rate
+ * @param[in]   gain Speed correction per phase error [1/s], 0 to only send the trajectory's speeds
+ * @param[in]   feedback_period Number of cycles between two position reads. \n
+ *              NB: the motors must not turn more than half a turn between two reads
+ * @retval      void
+ */
+void WheelDrive::setPhaseLoop(float gain, int feedback_period)
+{
+    if (feedback_period < 1) {
+        cout << "[KMR::dxlP1::WheelDrive] The feedback period is at least 1 cycle!" << endl;
+        exit(1);
+    }
+
+    m_gain = gain;
+    m_feedback_period = feedback_period;
+    m_nbr_cycles = 0;
+}
+
+/**
+ * @brief       Send the speeds of a control cycle: the trajectory's speeds, corrected by the phase
+ *              errors of the last position read. Every feedback period, the positions are read
+ *              right after the speeds are sent, and the corrections updated
+ * @param[in]   angles Goal continuous angles of the trajectory at this cycle [rad], same order as the ids
+ * @param[in]   speeds Goal speeds of the trajectory at this cycle [rad/s], same order as the ids
+ * @retval      void
+ * @note        The corrections are held between two reads. Motors that did not reply keep theirs
+ */
+void WheelDrive::drive(std::span<const float> angles, std::span<const float> speeds)
+{
+    if (angles.size() != m_ids.size() || speeds.size() != m_ids.size()) {
+        cout << "[KMR::dxlP1::WheelDrive] One goal angle and speed is needed per driven motor!" << endl;
+        exit(1);
+    }
+
+    for (int i=0; i<m_ids.size(); i++)
+        m_speeds[i] = speeds[i] + m_corrections[i];
+    m_speed_writer.addDataToWrite(std::span<const float>(m_speeds, m_ids.size()), m_ids);
+
+    if (++m_nbr_cycles < m_feedback_period) {
+        m_speed_writer.syncWrite();
+        return;
+    }
+
+    // Speeds and position request in one port write
+    m_nbr_cycles = 0;
+    m_batcher.addWrite(&m_speed_writer);
+    m_batcher.addRead(&m_position_reader);
+    m_batcher.flush();
+
+    const float *positions = m_position_reader.m_dataFromMotor;
+    for (int i=0; i<m_ids.size(); i++) {
+        if (m_position_reader.isValid(m_ids[i]))
+            m_corrections[i] = m_gain * (angles[i] - positions[i]);
+    }
+}
+
+/**
+ * @brief       Stop the motors: send a zero speed and clear the phase corrections
+ * @note        Also to be called before switching the motors to wheel mode: in position mode,
+ *              MOVING_SPEED is the speed limit, and the motors would start turning at it
+ * @retval      void
+ */
+void WheelDrive::stop()
+{
+    std::fill(m_corrections, m_corrections + m_ids.size(), 0);
+    m_nbr_cycles = 0;
+
+    m_speed_writer.addDataToWrite(std::span<const float>(STOP_DATA), m_ids);
+    m_speed_writer.syncWrite();
+}
+
+/**
+ * @brief       Stop the motors and set their goal positions to their present positions, so that
+ *              they stay in place when switched back to position mode (BaseRobot::setPositionMode)
+ * @note        The speed register is left at 0: no speed limit in position mode
+ * @retval      void
+ */
+void WheelDrive::hold()
+{
+    stop();
+
+    m_position_reader.syncRead(m_ids);
+    for (int i=0; i<m_ids.size(); i++) {
+        if (!m_position_reader.isValid(m_ids[i]))
+            cout << "[KMR::dxlP1::WheelDrive] Motor " << m_ids[i] << " did not reply, holding its last read position" << endl;
+    }
+
+    m_goal_writer.addDataToWrite(std::span<const float>(m_position_reader.m_dataFromMotor, m_ids.size()), m_ids);
+    m_goal_writer.syncWrite();
+}
+
+/**
+ * @brief       Get the continuous angles of the motors, as of the last position read
+ * @retval      Angles [rad], same order as the ids
+ */
+const float* WheelDrive::getAngles()
+{
+    return m_position_reader.m_dataFromMotor;
+}
+
+}
@@ -14,10 +14,14 @@
 
 #include "KMR_dxlP1_writer.hpp"
 #include <algorithm>
+#include <climits>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#define SYNC_WRITE_OVERHEAD     8   // Header(2) + ID + LEN + INST + ADDR + DATA_LEN + CHECKSUM
+#define WRITE_OVERHEAD          7   // Header(2) + ID + LEN + INST + ADDR + CHECKSUM
 
-#define MULTITURN_MAX   6144
-#define MULTITURN_MIN   -2048
 
 using std::cout;
 using std::endl;
@@ -30,31 +34,310 @@ namespace KMR::dxlP1
 
 /**
  * @brief       Constructor for a Writer handler
- * @param[in]   list_fields List of fields to be handled by the writer
+ * @param[in]   field Field to be handled by the writer
  * @param[in]   ids Motors to be handled by the writer
  * @param[in]   portHandler Object handling port communication
  * @param[in]   packetHandler Object handling packets
- * @param[in]   hal Previouly initialized Hal object
+ * @param[in]   hal Previously initialized Hal object, shared by all handlers
  */
 Writer::Writer(Fields field, vector<int> ids, dynamixel::PortHandler *portHandler,
-                            dynamixel::PacketHandler *packetHandler, Hal hal)
+                            dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal)
+: Writer(vector<Fields>{field}, ids, portHandler, packetHandler, hal)
+{
+}
+
+/**
+ * @brief       Constructor for a Writer handler of several fields
+ * @note        All fields are sent at once: each motor receives the address span going from the 
+ *              first to the last byte of the handled fields. Bytes between two handled fields 
+ *              are only allowed where the motors' control tables define no field. \n
+ *              Every handled field needs to receive data before its motor is first written to
+ * @param[in]   list_fields List of fields to be handled by the writer
+ * @param[in]   ids Motors to be handled by the writer
+ * @param[in]   portHandler Object handling port communication
+ * @param[in]   packetHandler Object handling packets
+ * @param[in]   hal Previously initialized Hal object, shared by all handlers
+ */
+Writer::Writer(vector<Fields> list_fields, vector<int> ids, dynamixel::PortHandler *portHandler,
+                            dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal)
 {
     portHandler_ = portHandler;
     packetHandler_ = packetHandler;
     m_hal = hal;
     m_ids = ids;
-    m_field = field;
 
-    getDataByteSize();
-    checkMotorCompatibility(field);
+    if (list_fields.empty()) {
+        cout << "[KMR::dxlP1::Writer] At least one field needs to be handled!" << endl;
+        exit(1);
+    }
+    m_fields = list_fields;
+    m_field = list_fields[0];
+
+    buildPlan();
+
+    // Locate each field, and the span covering them all
+    vector<uint8_t> addresses(m_fields.size());
+    int span_start = INT_MAX, span_end = 0;
+    m_write_fields = vector<Write_field>(m_fields.size());
+
+    for (int i=0; i<m_fields.size(); i++) {
+        if (std::find(m_fields.begin(), m_fields.begin()+i, m_fields[i]) != m_fields.begin()+i) {
+            cout << "[KMR::dxlP1::Writer] Field " << m_fields[i] << " is handled twice!" << endl;
+            exit(1);
+        }
+
+        addresses[i] = getFieldAddress(m_fields[i]);
+        m_write_fields[i].field = m_fields[i];
+        m_write_fields[i].length = getFieldLength(m_fields[i]);
+        m_write_fields[i].plan = (i == 0) ? m_plan : buildFieldPlan(m_fields[i]);
+
+        // Encoding constants, contiguous for batch conversions
+        const vector<Motor_plan>& plan = m_write_fields[i].plan;
+        m_write_fields[i].units = vector<float>(m_ids.size());
+        m_write_fields[i].biases = vector<float>(m_ids.size());
+        for (int j=0; j<m_ids.size(); j++) {
+            m_write_fields[i].units[j] = plan[j].unit;
+            m_write_fields[i].biases[j] = (plan[j].codec == ANGLE_CODEC) ? plan[j].center + 0.5f : 0;
+        }
+
+        span_start = std::min(span_start, (int) addresses[i]);
+        span_end = std::max(span_end, addresses[i] + m_write_fields[i].length);
+    }
+
+    for (int i=0; i<m_fields.size(); i++)
+        m_write_fields[i].offset = addresses[i] - span_start;
+
+    checkSpanGaps(span_start, span_end);
+
+    m_data_address = span_start;
+    m_data_byte_size = span_end - span_start;
+    m_staged = vector<uint8_t>(m_fields.size() * m_ids.size(), 0);
 
     m_groupSyncWriter = new dynamixel::GroupSyncWrite(portHandler_, packetHandler_, m_data_address, m_data_byte_size);
 
     // Create the table to save parametrized data (to be read or sent)
     m_dataParam = new uint8_t *[m_ids.size()];
+    buildFrame();
+
+    // Buffers of the batch conversions
+    m_values = new float[m_ids.size()];
+    m_units = new float[m_ids.size()];
+    m_biases = new float[m_ids.size()];
+    m_params = new int32_t[m_ids.size()];
+
+    // Delta suppression, disabled by default
+    m_sent_params = new int32_t[m_fields.size() * m_ids.size()]();
+    m_sent = new uint8_t[m_ids.size()]();
+    m_delta_ids = new int[m_ids.size()];
+    m_delta_slots = new int[m_ids.size()];
+    m_delta_frame = (m_frame_size != 0) ? new uint8_t[m_frame_size]() : nullptr;
+    m_broadcast_frame = new uint8_t[WRITE_OVERHEAD + m_data_byte_size]();
+
+}
+
+/**
+ * @brief       Build once the protocol 1 sync write frame sending the handled fields to all handled 
+ *              motors: FF FF FE LEN 83 ADDR DATA_LEN {ID DATA}... CHECKSUM. \n
+ *              The payload of each motor is stored in place in the frame, so that it is ready 
+ *              to be sent as soon as its data is updated
+ * @note        If the frame is longer than the SDK allows, the payloads are stored contiguously 
+ *              outside of any frame, and all writes go through the SDK group
+ * @retval      void
+ */
+void Writer::buildFrame()
+{
+    int nbr_motors = m_ids.size();
+    int params_length = nbr_motors * (1 + m_data_byte_size);
+    int frame_size = SYNC_WRITE_OVERHEAD + params_length;
+
+    if (frame_size > FRAME_MAX_LEN) {
+        m_frame = new uint8_t[params_length]();
+        for (int i=0; i<nbr_motors; i++)
+            m_dataParam[i] = m_frame + i*(1 + m_data_byte_size) + 1;
+        m_frame_size = 0;
+        return;
+    }
+
+    m_frame = new uint8_t[frame_size]();
+    m_frame_size = frame_size;
+
+    m_frame[FRAME_HEADER0] = 0xFF;
+    m_frame[FRAME_HEADER1] = 0xFF;
+    m_frame[FRAME_ID] = BROADCAST_ID;
+    m_frame[FRAME_LENGTH] = params_length + 4;
+    m_frame[FRAME_INSTRUCTION] = INST_SYNC_WRITE;
+    m_frame[FRAME_PARAMETER0] = m_data_address;
+    m_frame[FRAME_PARAMETER0 + 1] = m_data_byte_size;
+
+    for (int i=0; i<nbr_motors; i++) {
+        uint8_t *motor_params = m_frame + FRAME_PARAMETER0 + 2 + i*(1 + m_data_byte_size);
+        motor_params[0] = m_ids[i];
+        m_dataParam[i] = motor_params + 1;
+    }
+
+    // Checksum over everything but the header, the payloads being all zeros
+    m_frame_sum = 0;
+    for (int i=FRAME_ID; i<frame_size-1; i++)
+        m_frame_sum += m_frame[i];
+}
+
+/**
+ * @brief       Write the checksum of the sync write frame, making it ready to be sent
+ * @retval      void
+ */
+void Writer::closeFrame()
+{
+    m_frame[m_frame_size-1] = ~m_frame_sum;
+}
+
+/**
+ * @brief       Get the sync write frame to be sent to the handled motors: the frame to all motors, 
+ *              or with delta suppression, a frame to the motors whose data changed
+ * @param[out]  frame Frame to be sent
+ * @retval      int: byte size of the frame, 0 if there is nothing to send
+ */
+int Writer::prepareFrame(const uint8_t*& frame)
+{
+    std::span<const int> ids(m_ids);
+    int frame_size = 0;
+
+    checkAllStaged();
+
+    if (m_delta_enabled) {
+        ids = std::span<const int>(m_delta_ids, selectChanged(m_ids, m_delta_ids));
+        if (ids.empty())
+            return 0;
+    }
+
+    if (m_broadcast_enabled && (frame_size = buildBroadcastFrame(ids)) != 0) {
+        frame = m_broadcast_frame;
+        return frame_size;
+    }
+
+    if (ids.size() < m_ids.size()) {
+        frame = m_delta_frame;
+        return buildDeltaFrame(ids);
+    }
+
+    closeFrame();
+    frame = m_frame;
+    return m_frame_size;
+}
+
+/**
+ * @brief       Send a sync write frame with a single port write
+ * @param[in]   frame Frame to be sent
+ * @param[in]   frame_size Byte size of the frame
+ * @retval      int: communication result, as defined by the SDK
+ */
+int Writer::sendFrame(const uint8_t *frame, int frame_size)
+{
+    if (portHandler_->is_using_)
+        return COMM_PORT_BUSY;
+    portHandler_->is_using_ = true;
+
+    portHandler_->clearPort();
+    int written_length = portHandler_->writePort((uint8_t*) frame, frame_size);
+
+    portHandler_->is_using_ = false;
+
+    if (written_length != frame_size)
+        return COMM_TX_FAIL;
+    return COMM_SUCCESS;
+}
+
+/**
+ * @brief       Check that the span sent to motors does not overwrite anything else than the 
+ *              handled fields: handled fields must not overlap, and unhandled bytes must not 
+ *              belong to any field of the motors' control tables
+ * @param[in]   span_start First address of the span
+ * @param[in]   span_end Address following the last byte of the span
+ * @retval      void
+ */
+void Writer::checkSpanGaps(int span_start, int span_end)
+{
+    vector<int> owner(span_end - span_start, -1);
+
+    // Bytes covered by the handled fields
+    for (int i=0; i<m_write_fields.size(); i++) {
+        for (int j=0; j<m_write_fields[i].length; j++) {
+            int byte = m_write_fields[i].offset + j;
+            if (owner[byte] != -1) {
+                cout << "[KMR::dxlP1::Writer] Fields " << m_fields[owner[byte]] << " and " 
+                     << m_fields[i] << " overlap!" << endl;
+                exit(1);
+            }
+            owner[byte] = i;
+        }
+    }
+
+    // Unhandled bytes must not be part of another field
+    for (int i=0; i<m_ids.size(); i++) {
+        for (int f=0; f<NBR_FIELDS; f++) {
+            Fields field = (Fields) f;
+            if (std::find(m_fields.begin(), m_fields.end(), field) != m_fields.end())
+                continue;
+
+            Motor_data_field data_field = m_hal->getControlParametersFromID(m_ids[i], field);
+            if (data_field.length == 0)
+                continue;
+
+            for (int j=0; j<data_field.length; j++) {
+                int byte = data_field.address + j - span_start;
+                if (byte >= 0 && byte < owner.size()) {
+                    cout << "[KMR::dxlP1::Writer] Motor " << m_ids[i] << ": field " << field 
+                         << " lies between the handled fields, add it to the writer!" << endl;
+                    exit(1);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief       Get the index of a field in the list of handled fields
+ * @param[in]   field Query field
+ * @retval      Index of the field in m_fields
+ */
+int Writer::getFieldIndex(Fields field)
+{
+    if (m_fields.size() == 1 && field == m_field)
+        return 0;
+
+    checkFieldValidity(field);
+    return std::find(m_fields.begin(), m_fields.end(), field) - m_fields.begin();
+}
+
+/**
+ * @brief       Check that all handled fields of all motors received data at least once. \n
+ *              Once true, it stays true
+ * @retval      void
+ */
+void Writer::checkAllStaged()
+{
+    if (m_all_staged)
+        return;
+
     for (int i=0; i<m_ids.size(); i++)
-        m_dataParam[i] = new uint8_t[m_data_byte_size];
+        checkStaged(i);
+    m_all_staged = true;
+}
 
+/**
+ * @brief       Check that all handled fields of a motor received data at least once, 
+ *              so that no unset field is sent
+ * @param[in]   motor_idx Index of the motor in the list of handled motors
+ * @retval      void
+ */
+void Writer::checkStaged(int motor_idx)
+{
+    for (int f=0; f<m_fields.size(); f++) {
+        if (!m_staged[f*m_ids.size() + motor_idx]) {
+            cout << "[KMR::dxlP1::Writer] Motor " << m_ids[motor_idx] << ": no data was added for field " 
+                 << m_fields[f] << "!" << endl;
+            exit(1);
+        }
+    }
 }
 
 /**
@@ -62,7 +345,21 @@ Writer::Writer(Fields field, vector<int> ids, dynamixel::PortHandler *portHandle
  */
 Writer::~Writer()
 {
-    //cout << "The Dxl Writer object is being deleted" << endl;
+    delete m_groupSyncWriter;
+
+    delete[] m_dataParam;
+    delete[] m_frame;
+    delete[] m_values;
+    delete[] m_units;
+    delete[] m_biases;
+    delete[] m_params;
+
+    delete[] m_sent_params;
+    delete[] m_sent;
+    delete[] m_delta_ids;
+    delete[] m_delta_slots;
+    delete[] m_delta_frame;
+    delete[] m_broadcast_frame;
 }
 
 
@@ -92,21 +389,21 @@ bool Writer::addParam(uint8_t id, uint8_t* data)
 }
 
 /**
- * @brief       Send the previously prepared data with addDataToWrite to motors
+ * @brief       Register the motors to be written and their data in the SDK group
  * @param[in]   ids List of motors who will receive data
  * @retval      void
  */
-void Writer::syncWrite(vector<int> ids)
+void Writer::registerParams(std::span<const int> ids)
 {
     bool dxl_addparam_result;
-    int dxl_comm_result = COMM_TX_FAIL;   
     int id, motor_idx;
 
     clearParam();
 
     for(int i=0; i<ids.size(); i++) {
         id = ids[i];
-        motor_idx = getMotorIndexFromID(id);
+        motor_idx = m_slot_from_id[id];
+        checkStaged(motor_idx);
 
         dxl_addparam_result = addParam((uint8_t) id, m_dataParam[motor_idx]);
 
@@ -115,52 +412,133 @@ void Writer::syncWrite(vector<int> ids)
             exit(1);
         }
     }
+}
+
+/**
+ * @brief       Send the previously prepared data with addDataToWrite to all handled motors
+ * @note        Uses the pre-built frame when possible: no copy, no allocation, one port write
+ * @retval      void
+ */
+void Writer::syncWrite()
+{
+    int dxl_comm_result = COMM_TX_FAIL;
+
+    if (m_frame_size == 0) {
+        syncWrite(std::span<const int>(m_ids));
+        return;
+    }
+
+    const uint8_t *frame;
+    int frame_size = prepareFrame(frame);
+    if (frame_size == 0)
+        return;
+
+    dxl_comm_result = sendFrame(frame, frame_size);
+    if (dxl_comm_result != COMM_SUCCESS) {
+        cout << packetHandler_->getTxRxResult(dxl_comm_result) << endl;
+        unmarkSent();
+    }
+}
+
+/**
+ * @brief       Send the previously prepared data with addDataToWrite to motors
+ * @param[in]   ids List of motors who will receive data
+ * @retval      void
+ */
+void Writer::syncWrite(std::span<const int> ids)
+{
+    int dxl_comm_result = COMM_TX_FAIL;   
+
+    // Only the motors whose data changed
+    if (m_delta_enabled) {
+        ids = std::span<const int>(m_delta_ids, selectChanged(ids, m_delta_ids));
+        if (ids.empty())
+            return;
+    }
+
+    // Same data for all motors on the bus
+    int frame_size = 0;
+    if (m_broadcast_enabled && (frame_size = buildBroadcastFrame(ids)) != 0) {
+        dxl_comm_result = sendFrame(m_broadcast_frame, frame_size);
+        if (dxl_comm_result != COMM_SUCCESS) {
+            cout << packetHandler_->getTxRxResult(dxl_comm_result) << endl;
+            unmarkSent();
+        }
+        return;
+    }
+
+    registerParams(ids);
+    m_registered_serial = 0;
 
     // Send the packet
     dxl_comm_result = m_groupSyncWriter->txPacket();
-    if (dxl_comm_result != COMM_SUCCESS)
+    if (dxl_comm_result != COMM_SUCCESS) {
         cout << packetHandler_->getTxRxResult(dxl_comm_result) << endl;
-
+        unmarkSent();
+    }
 }
 
-                                                                                                                                                                                     
 /**
- * @brief       Convert angle input into position data based on motor model provided
- * @param[in]   angle Angle to be converted, in rad
- * @param[in]   id ID of the motor to receive the position input
- * @return      Position value corresponding to the joint angle (0 degrees or rad -> mid-position)
- */
-int Writer::angle2Position(float angle, int id)
-{
-	int position = 2048;
-    int motor_idx = m_hal.getMotorsListIndexFromID(id);
-    int model = m_hal.m_motors_list[motor_idx].scanned_model;
-    float units = m_hal.getControlParametersFromID(id, GOAL_POS).unit;
-    Motor motor = m_hal.getMotorFromID(id);
-    int toReset = m_hal.m_motors_list[motor_idx].toReset;
-
-    if (model == 1030 || model == 1000 || model == 310){
-    	int Model_max_position = 4095;
-        int Model_min_position = 0;
-		position = angle/units + Model_max_position/2 + 0.5;
-
-        if (!motor.multiturn)
-            bindParameter(Model_min_position, Model_max_position, position);
-        else {
-            if (multiturnOverLimit(position))
-                m_hal.updateResetStatus(id, 1);
-
-
-            // Force values (used for motor multiturn resetting)
-            else if (toReset == 1)  // Need to set to join control mode
-                position = 0;
-            else if (toReset == 2) // Need to set to multiturn control mode
-                position = 4095;
-        }
+ * @brief       Send the previously prepared data with addDataToWrite to a prepared set of motors
+ * @note        The motors stay registered in the SDK group from one call to the next: 
+ *              only their data is refreshed
+ * @param[in]   set Motors who will receive data, prepared with prepareIDs
+ * @retval      void
+ */
+void Writer::syncWrite(const Prepared_ids& set)
+{
+    int dxl_comm_result = COMM_TX_FAIL;
+    int id;
+
+    checkPreparedIDs(set);
+
+    if (set.all_handled && m_frame_size != 0) {
+        syncWrite();
+        return;
+    }
+
+    // The motors to be sent change with their data
+    if (m_delta_enabled || m_broadcast_enabled) {
+        syncWrite(std::span<const int>(set.ids));
+        return;
+    }
+
+    if (m_registered_serial != set.serial) {
+        registerParams(set.ids);
+        m_registered_serial = set.serial;
     }
     else {
-        cout << "This model is unknown, cannot calculate position from angle!" << endl;
-        return (1);
+        for (int i=0; i<set.ids.size(); i++) {
+            id = set.ids[i];
+            m_groupSyncWriter->changeParam((uint8_t) id, m_dataParam[m_slot_from_id[id]]);
+        }
+    }
+
+    // Send the packet
+    dxl_comm_result = m_groupSyncWriter->txPacket();
+    if (dxl_comm_result != COMM_SUCCESS)
+        cout << packetHandler_->getTxRxResult(dxl_comm_result) << endl;
+}
+
+                                                                                                                                                                                     
+/**
+ * @brief       Apply the motor's position limits to an encoded angle, and flag multiturn motors in need of a reset
+ * @param[in]   position Position encoded from the goal angle (0 rad -> mid-position), continuous for multiturn goals
+ * @param[in]   plan Resolved info of the motor for the converted field
+ * @return      Position value to be sent to the motor
+ */
+int Writer::limitPosition(int position, const Motor_plan& plan)
+{
+    if (!plan.multiturn)
+        bindParameter(plan.min_position, plan.max_position, position);
+
+    else if (plan.unwrapped) {
+        // Continuous position to hardware position
+        position -= m_hal->turnOffsetAt(plan.hal_idx);
+
+        // Flag the motor for a reset, carried out by BaseRobot::resetMultiturnMotors
+        if (multiturnOverLimit(position, plan) && m_hal->resetStatusAt(plan.hal_idx) == RESET_IDLE)
+            m_hal->updateResetStatusAt(plan.hal_idx, RESET_FLAGGED);
     }
 
     return position;
@@ -188,27 +566,26 @@ void Writer::bindParameter(int lower_bound, int upper_bound, int& param)
  * @brief       Save a parametrized data into the general table
  * @param[in]   data Parametrized data to be sent to motor
  * @param[in]   motor_idx Index of the motor
- * @param[in]   field_idx Index of the field (type of data)
+ * @param[in]   field_offset Position of the field in the bytes sent to the motor
  * @param[in]   field_length Byte size of the data
  * @retval      void
  */
-void Writer::populateDataParam(int32_t data, int motor_idx, int field_length)
+void Writer::populateDataParam(int32_t data, int motor_idx, int field_offset, int field_length)
 {
-    if (field_length == 4) {
-        m_dataParam[motor_idx][0] = DXL_LOBYTE(DXL_LOWORD(data));
-        m_dataParam[motor_idx][1] = DXL_HIBYTE(DXL_LOWORD(data));
-        m_dataParam[motor_idx][2] = DXL_LOBYTE(DXL_HIWORD(data));
-        m_dataParam[motor_idx][3] = DXL_HIBYTE(DXL_HIWORD(data));
-    }
-    else if (field_length == 2) {
-        m_dataParam[motor_idx][0] = DXL_LOBYTE(DXL_LOWORD(data));
-        m_dataParam[motor_idx][1] = DXL_HIBYTE(DXL_LOWORD(data));
-    }
-    else if (field_length == 1) {
-        m_dataParam[motor_idx][0] = DXL_LOBYTE(DXL_LOWORD(data));
-    }
-    else
+    uint8_t bytes[4];
+
+    if (field_length == 4)
+        encodeParam<4>(data, bytes);
+    else if (field_length == 2)
+        encodeParam<2>(data, bytes);
+    else if (field_length == 1)
+        encodeParam<1>(data, bytes);
+    else {
         cout<< "Wrong number of parameters to populate the parametrized matrix!" <<endl;
+        return;
+    }
+
+    patchParam(m_dataParam[motor_idx] + field_offset, bytes, field_length);
 }
 
 
@@ -217,14 +594,217 @@ void Writer::populateDataParam(int32_t data, int motor_idx, int field_length)
  * @param[in]   position Parametrized goal position of a motor
  * @retval      Boolean: 1 if over a full turn, 0 otherwise
  */
-bool Writer::multiturnOverLimit(int position)
+bool Writer::multiturnOverLimit(int position, const Motor_plan& plan)
 {
-    if (position > MULTITURN_MAX || position < MULTITURN_MIN)
+    if (position > plan.reset_max || position < plan.reset_min)
         return true;
     else
         return false;
 }
 
 
+/*
+ *****************************************************************************
+ *                             Delta suppression
+ ****************************************************************************/
+
+/**
+ * @brief       Only send the motors whose data changed since it was last sent to them
+ * @note        The first sync write after enabling sends all motors
+ * @param[in]   deadband Change [raw ticks] of a field below or equal to which it is considered unchanged
+ * @param[in]   refresh_period Number of sync writes after which all motors are sent anyway, 0 for never
+ * @retval      void
+ */
+void Writer::setDeltaSuppression(int deadband, int refresh_period)
+{
+    if (deadband < 0 || refresh_period < 0) {
+        cout << "[KMR::dxlP1::Writer] The deadband and refresh period cannot be negative!" << endl;
+        exit(1);
+    }
+
+    m_delta_enabled = true;
+    m_deadband = deadband;
+    m_refresh_period = refresh_period;
+    m_nbr_delta_writes = 0;
+    std::fill(m_sent, m_sent + m_ids.size(), 0);
+}
+
+/**
+ * @brief       Send the data of all input motors with each sync write (default behavior)
+ * @retval      void
+ */
+void Writer::disableDeltaSuppression()
+{
+    m_delta_enabled = false;
+}
+
+/**
+ * @brief       Get the parametrized data of a field currently staged for a motor
+ * @param[in]   motor_idx Index of the motor in the list of handled motors
+ * @param[in]   field_idx Index of the field in the list of handled fields
+ * @retval      Parametrized data, sign-extended for signed fields, signed for sign-magnitude fields
+ */
+int32_t Writer::getStagedParam(int motor_idx, int field_idx)
+{
+    const Write_field& write_field = m_write_fields[field_idx];
+    const uint8_t *bytes = m_dataParam[motor_idx] + write_field.offset;
+    bool is_signed = FIELD_INFOS[write_field.field].is_signed;
+
+    if (FIELD_INFOS[write_field.field].codec == DIRECTION_CODEC)
+        return decodeDirection(DXL_MAKEWORD(bytes[0], bytes[1]));
+    else if (write_field.length == 1)
+        return is_signed ? (int8_t) bytes[0] : bytes[0];
+    else if (write_field.length == 2)
+        return is_signed ? (int16_t) DXL_MAKEWORD(bytes[0], bytes[1]) : DXL_MAKEWORD(bytes[0], bytes[1]);
+    else
+        return (int32_t) DXL_MAKEDWORD(DXL_MAKEWORD(bytes[0], bytes[1]), DXL_MAKEWORD(bytes[2], bytes[3]));
+}
+
+/**
+ * @brief       Select the input motors to be sent: never sent yet, data changed beyond the deadband, 
+ *              or refresh due. Their data is then considered as sent, until unmarkSent is called
+ * @param[in]   ids List of motors who could receive data
+ * @param[out]  changed_ids List of motors to be sent, at most as long as the list of handled motors
+ * @retval      int: number of motors to be sent
+ */
+int Writer::selectChanged(std::span<const int> ids, int *changed_ids)
+{
+    int nbr_motors = m_ids.size();
+    int nbr_changed = 0;
+    bool refresh = false;
+
+    m_nbr_delta_slots = 0;
+
+    if (m_refresh_period > 0 && ++m_nbr_delta_writes >= m_refresh_period) {
+        refresh = true;
+        m_nbr_delta_writes = 0;
+    }
+
+    for (int i=0; i<ids.size() && nbr_changed<nbr_motors; i++) {
+        int motor_idx = m_slot_from_id[ids[i]];
+        checkStaged(motor_idx);
+        bool changed = refresh || !m_sent[motor_idx];
+
+        for (int f=0; f<m_fields.size() && !changed; f++) {
+            int32_t delta = getStagedParam(motor_idx, f) - m_sent_params[f*nbr_motors + motor_idx];
+            changed = (std::abs(delta) > m_deadband);
+        }
+
+        if (changed) {
+            changed_ids[nbr_changed++] = ids[i];
+            m_delta_slots[m_nbr_delta_slots++] = motor_idx;
+            m_sent[motor_idx] = 1;
+            for (int f=0; f<m_fields.size(); f++)
+                m_sent_params[f*nbr_motors + motor_idx] = getStagedParam(motor_idx, f);
+        }
+    }
+
+    return nbr_changed;
+}
+
+/**
+ * @brief       Consider the data of the motors last selected by selectChanged as not sent, after
+ *              the port write of their frame failed: they are sent again with the next sync write
+ * @retval      void
+ */
+void Writer::unmarkSent()
+{
+    for (int i=0; i<m_nbr_delta_slots; i++)
+        m_sent[m_delta_slots[i]] = 0;
+    m_nbr_delta_slots = 0;
+}
+
+/**
+ * @brief       Build the sync write frame to a subset of the handled motors, from the staged data
+ * @param[in]   ids List of motors who will receive data
+ * @retval      int: byte size of the frame
+ */
+int Writer::buildDeltaFrame(std::span<const int> ids)
+{
+    int params_length = ids.size() * (1 + m_data_byte_size);
+    int frame_size = SYNC_WRITE_OVERHEAD + params_length;
+
+    // Same header as the frame to all motors
+    memcpy(m_delta_frame, m_frame, FRAME_PARAMETER0 + 2);
+    m_delta_frame[FRAME_LENGTH] = params_length + 4;
+
+    uint8_t *motor_params = m_delta_frame + FRAME_PARAMETER0 + 2;
+    for (int i=0; i<ids.size(); i++) {
+        int motor_idx = m_slot_from_id[ids[i]];
+        motor_params[0] = ids[i];
+        memcpy(motor_params + 1, m_dataParam[motor_idx], m_data_byte_size);
+        motor_params += 1 + m_data_byte_size;
+    }
+
+    uint8_t checksum = 0;
+    for (int i=FRAME_ID; i<frame_size-1; i++)
+        checksum += m_delta_frame[i];
+    m_delta_frame[frame_size-1] = ~checksum;
+
+    return frame_size;
+}
+
+
+/*
+ *****************************************************************************
+ *                             Broadcast writes
+ ****************************************************************************/
+
+/**
+ * @brief       Send the data with a single broadcast write when all handled motors are written 
+ *              with the same data
+ * @note        A broadcast write reaches every motor on the bus: enable it only if the Writer 
+ *              handles all of them
+ * @retval      void
+ */
+void Writer::enableBroadcast()
+{
+    m_broadcast_enabled = true;
+}
+
+/**
+ * @brief       Build the write frame to the broadcast ID, if the input motors are all the handled 
+ *              motors and all get the same data
+ * @param[in]   ids List of motors who will receive data
+ * @retval      int: byte size of the frame, 0 if a broadcast write cannot be used
+ */
+int Writer::buildBroadcastFrame(std::span<const int> ids)
+{
+    bool listed[NBR_IDS] = {false};
+    int nbr_listed = 0;
+
+    if (ids.size() < m_ids.size())
+        return 0;
+
+    // All handled motors, all with the same data
+    const uint8_t *data = m_dataParam[m_slot_from_id[ids[0]]];
+    for (int i=0; i<ids.size(); i++) {
+        if (memcmp(m_dataParam[m_slot_from_id[ids[i]]], data, m_data_byte_size) != 0)
+            return 0;
+        if (!listed[ids[i]]) {
+            listed[ids[i]] = true;
+            nbr_listed++;
+        }
+    }
+    if (nbr_listed != m_ids.size())
+        return 0;
+
+    int frame_size = WRITE_OVERHEAD + m_data_byte_size;
+
+    m_broadcast_frame[FRAME_HEADER0] = 0xFF;
+    m_broadcast_frame[FRAME_HEADER1] = 0xFF;
+    m_broadcast_frame[FRAME_ID] = BROADCAST_ID;
+    m_broadcast_frame[FRAME_LENGTH] = m_data_byte_size + 3;
+    m_broadcast_frame[FRAME_INSTRUCTION] = INST_WRITE;
+    m_broadcast_frame[FRAME_PARAMETER0] = m_data_address;
+    memcpy(m_broadcast_frame + FRAME_PARAMETER0 + 1, data, m_data_byte_size);
+
+    uint8_t checksum = 0;
+    for (int i=FRAME_ID; i<frame_size-1; i++)
+        checksum += m_broadcast_frame[i];
+    m_broadcast_frame[frame_size-1] = ~checksum;
+
+    return frame_size;
+}
 
 }
\ No newline at end of file
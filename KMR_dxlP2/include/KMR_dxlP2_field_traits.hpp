@@ -0,0 +1,120 @@
+/**
+ ******************************************************************************
+ * @file            KMR_dxlP2_field_traits.hpp
+ * @brief           Properties of the protocol 2 control fields
+ ******************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ ******************************************************************************
+ */
+
+#ifndef KMR_DXLP2_FIELD_TRAITS_HPP
+#define KMR_DXLP2_FIELD_TRAITS_HPP
+
+#include "KMR_dxlP2_hal.hpp"
+#include <cstdint>
+
+namespace KMR::dxlP2
+{
+
+/**
+ * @brief       Conversion applied by a handler between SI units and parametrized data
+ */
+enum Codec_kinds
+{
+	SCALAR_CODEC, ANGLE_CODEC
+};
+
+/**
+ * @brief       Protocol-level properties of a data field, common to all motor models
+ */
+struct Field_info {
+	Fields field;
+	Codec_kinds codec;		// Conversion between SI units and parametrized data
+	int length;				// Byte size of the field
+	bool is_signed;			// Parametrized data is a two's complement value
+	bool is_integer;		// Data is a count/flag (int) rather than a physical quantity (float)
+};
+
+/**
+ * @brief       Properties of all data fields, indexed by Fields
+ */
+inline constexpr Field_info FIELD_INFOS[NBR_FIELDS] = {
+	// EEPROM
+	{MODEL_NBR,        SCALAR_CODEC, 2, false, true},
+	{MODEL_INFO,       SCALAR_CODEC, 4, false, true},
+	{FIRMWARE,         SCALAR_CODEC, 1, false, true},
+	{ID,               SCALAR_CODEC, 1, false, true},
+	{BAUDRATE,         SCALAR_CODEC, 1, false, true},
+	{RETURN_DELAY,     SCALAR_CODEC, 1, false, false},
+	{DRIVE_MODE,       SCALAR_CODEC, 1, false, true},
+	{OPERATING_MODE,   SCALAR_CODEC, 1, false, true},
+	{SHADOW_ID,        SCALAR_CODEC, 1, false, true},
+	{PROTOCOL,         SCALAR_CODEC, 1, false, true},
+	{HOMING_OFFSET,    SCALAR_CODEC, 4, true,  false},
+	{MOVING_THRESHOLD, SCALAR_CODEC, 4, false, false},
+	{TEMP_LIMIT,       SCALAR_CODEC, 1, false, false},
+	{MAX_VOLT_LIMIT,   SCALAR_CODEC, 2, false, false},
+	{MIN_VOLT_LIMIT,   SCALAR_CODEC, 2, false, false},
+	{PWM_LIMIT,        SCALAR_CODEC, 2, false, false},
+	{CURRENT_LIMIT,    SCALAR_CODEC, 2, false, false},
+	{ACC_LIMIT,        SCALAR_CODEC, 4, false, false},
+	{VEL_LIMIT,        SCALAR_CODEC, 4, false, false},
+	{MAX_POS_LIMIT,    ANGLE_CODEC,  4, false, false},
+	{MIN_POS_LIMIT,    ANGLE_CODEC,  4, false, false},
+	{SHUTDOWN,         SCALAR_CODEC, 1, false, true},
+	// RAM
+	{TRQ_ENABLE,       SCALAR_CODEC, 1, false, true},
+	{LED,              SCALAR_CODEC, 1, false, true},
+	{STATUS_RETURN,    SCALAR_CODEC, 1, false, true},
+	{REGISTERED,       SCALAR_CODEC, 1, false, true},
+	{HW_ERROR,         SCALAR_CODEC, 1, false, true},
+	{VEL_I_GAIN,       SCALAR_CODEC, 2, false, true},
+	{VEL_P_GAIN,       SCALAR_CODEC, 2, false, true},
+	{POS_D_GAIN,       SCALAR_CODEC, 2, false, true},
+	{POS_I_GAIN,       SCALAR_CODEC, 2, false, true},
+	{POS_P_GAIN,       SCALAR_CODEC, 2, false, true},
+	{FF_ACC_GAIN,      SCALAR_CODEC, 2, false, true},
+	{FF_VEL_GAIN,      SCALAR_CODEC, 2, false, true},
+	{BUS_WATCHDOG,     SCALAR_CODEC, 1, false, false},
+	{GOAL_PWM,         SCALAR_CODEC, 2, true,  false},
+	{GOAL_CURRENT,     SCALAR_CODEC, 2, true,  false},
+	{GOAL_VEL,         SCALAR_CODEC, 4, true,  false},
+	{PROFILE_ACC,      SCALAR_CODEC, 4, false, false},
+	{PROFILE_VEL,      SCALAR_CODEC, 4, false, false},
+	{GOAL_POS,         ANGLE_CODEC,  4, true,  false},
+	{REALTIME_TICK,    SCALAR_CODEC, 2, false, false},
+	{MOVING,           SCALAR_CODEC, 1, false, true},
+	{MOVING_STATUS,    SCALAR_CODEC, 1, false, true},
+	{PRESENT_PWM,      SCALAR_CODEC, 2, true,  false},
+	{PRESENT_CURRENT,  SCALAR_CODEC, 2, true,  false},
+	{PRESENT_VEL,      SCALAR_CODEC, 4, true,  false},
+	{PRESENT_POS,      ANGLE_CODEC,  4, true,  false},
+	{VEL_TRAJECTORY,   SCALAR_CODEC, 4, true,  false},
+	{POS_TRAJECTORY,   ANGLE_CODEC,  4, true,  false},
+	{PRESENT_VOLT,     SCALAR_CODEC, 2, false, false},
+	{PRESENT_TEMP,     SCALAR_CODEC, 1, false, false},
+	{INDIR_ADDRESS_1,  SCALAR_CODEC, 2, false, true},
+	{INDIR_DATA_1,     SCALAR_CODEC, 1, false, true},
+};
+
+/**
+ * @brief       Check that FIELD_INFOS is ordered as the Fields enumerate
+ */
+constexpr bool fieldInfosOrdered()
+{
+	for (int i=0; i<NBR_FIELDS; i++) {
+		if (FIELD_INFOS[i].field != i)
+			return false;
+	}
+	return true;
+}
+static_assert(fieldInfosOrdered(), "FIELD_INFOS must follow the order of the Fields enumerate");
+
+}
+
+#endif
@@ -0,0 +1,208 @@
+/**
+ *****************************************************************************
+ * @file            KMR_dxlP2_hal.hpp
+ * @brief           Header for KMR_dxlP2_hal.cpp file
+ *****************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ *****************************************************************************
+ */
+
+#ifndef KMR_DXLP2_HAL_HPP
+#define KMR_DXLP2_HAL_HPP
+
+#include <string>
+#include <iostream>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <memory>
+#include "KMR_dxlP2_motor_models.hpp"   // Generated at build time from config/motor_models
+
+#define NBR_IDS     256     // Size of the dense ID->index lookup tables
+
+namespace KMR::dxlP2
+{
+
+/**
+ * @brief   Structure saving the info of a data field
+ * @note    Protocol 2 addresses are 2 bytes long
+ */
+struct Motor_data_field {
+    std::uint16_t address;
+    std::uint8_t length;
+    float unit;
+};
+
+
+/**
+ * @brief   Structure used to store info from a YAML::Node during parsing the motors' control tables
+ */
+struct Data_node {
+    std::string field_name;
+    int address;
+    int length;
+    float unit;
+};
+
+/**
+ * @brief   Structure used to store info from a YAML::Node during motor config parsing
+ */
+struct Motor_node {
+    std::string model_name;
+    int id;
+    int multiturn;
+};
+
+/**
+ * @brief       Exhaustive list of all possible control modes for Dynamixel motors
+ */
+struct Control_modes {
+    uint8_t current_control;
+    uint8_t velocity_control;
+    uint8_t position_control;
+    uint8_t multiturn_control;
+    uint8_t current_based_position_control;
+    uint8_t PWM_control;
+};
+
+/**
+ * @brief       Position encoding of a motor model, used for conversions between angles and positions
+ */
+struct Position_codec {
+    int resolution;     // Number of positions per turn
+    int center;         // Position corresponding to the 0 rad angle
+    int min_position;   // Position range in joint mode
+    int max_position;
+    int multiturn_min;  // Position range in multiturn mode, empty if not supported
+    int multiturn_max;
+};
+
+/**
+ * @brief   Structure saving the info of a single motor: both config-wise (ID, model...)
+ *          and specific to the project (occupied indirect addresses, reset status...)
+ * @note    The Hal stores motors as structure-of-arrays: this structure is only an
+ *          assembled copy, used while parsing and for one-off queries
+ */
+struct Motor {
+    int id;
+    Motor_models model;
+    int multiturn;
+    Control_modes control_modes;
+
+    uint8_t indir_address_offset = 0;
+    uint8_t indir_data_offset = 0;
+    int scanned_model = 0;
+    int toReset = 0;
+};
+
+
+/**
+ * @brief   Enumerate of all data fields in a dynamixel motor (protocol 2, MX series firmware 2.0)
+ */
+enum Fields
+{
+    MODEL_NBR, MODEL_INFO, FIRMWARE, ID, BAUDRATE, RETURN_DELAY, DRIVE_MODE, OPERATING_MODE,
+    SHADOW_ID, PROTOCOL, HOMING_OFFSET, MOVING_THRESHOLD, TEMP_LIMIT, MAX_VOLT_LIMIT, MIN_VOLT_LIMIT,
+    PWM_LIMIT, CURRENT_LIMIT, ACC_LIMIT, VEL_LIMIT, MAX_POS_LIMIT, MIN_POS_LIMIT, SHUTDOWN,
+    TRQ_ENABLE, LED, STATUS_RETURN, REGISTERED, HW_ERROR, VEL_I_GAIN, VEL_P_GAIN,
+    POS_D_GAIN, POS_I_GAIN, POS_P_GAIN, FF_ACC_GAIN, FF_VEL_GAIN, BUS_WATCHDOG,
+    GOAL_PWM, GOAL_CURRENT, GOAL_VEL, PROFILE_ACC, PROFILE_VEL, GOAL_POS, REALTIME_TICK,
+    MOVING, MOVING_STATUS, PRESENT_PWM, PRESENT_CURRENT, PRESENT_VEL, PRESENT_POS,
+    VEL_TRAJECTORY, POS_TRAJECTORY, PRESENT_VOLT, PRESENT_TEMP, INDIR_ADDRESS_1, INDIR_DATA_1,
+    NBR_FIELDS, UNDEF_F
+};
+
+
+/**
+ * @brief       Hardware abstraction layer for Dynamixel motors
+ * @details     The lowest-level element in the library. The Hal class serves primarily as
+ *              an abstraction layer, providing high-level functions to get the Dynamixel control
+ *              table addresses by creating a control table. \n
+ *              The control tables are compiled into the library from config/motor_models,
+ *              but can be reloaded from the yaml files at runtime. \n
+ *              It also parses the project's motors configuration file, and allocates the
+ *              motors' indirect addresses to the handlers. \n
+ *              A single Hal is shared (std::shared_ptr) by a robot and all its handlers.
+ */
+class Hal {
+private:
+    std::vector<std::string> m_unique_motor_models_list;   // List of unique motor models used in the robot
+    std::vector<Motor> m_parsed_motors;   // Motors read from the config file, before storage allocation
+    uint8_t* m_storage;     // Single allocation holding all the arrays below
+    size_t m_storage_size;
+
+    void allocate_storage(int nbr_motors);
+    void load_compiled_control_table();
+    void populate_control_table(char* path_to_KMR_dxl);
+    void parse_motor_config(char* config_file);
+    Motor_models string2Motors_models(const std::string& str);
+    Fields string2Fields(const std::string& str);
+    void dataNode2Motor_data_field(Data_node& data_node, Motor_data_field& motor_data_field);
+    void motorNode2Motor(Motor_node& motor_node, Motor& motor);
+    void update_unique_models_list(std::string motor_model_string);
+    Motor_models getModelFromID(int id) const;
+
+public:
+    int m_tot_nbr_motors;   // Number of motors used in the robot
+    std::vector<int> m_all_IDs;  // All motor IDs in the robot
+
+    // Motors' info as structure-of-arrays, indexed by motors list index. Hot arrays first
+    int* m_motor_ids;                   // ID of each motor
+    int* m_reset_status;                // 1 if the multiturn motor needs a reset
+    int* m_multiturn;                   // 1 if the motor is used in multiturn mode
+    Motor_models* m_motor_models;       // Model of each motor
+    int16_t* m_idx_from_id;             // Motors list index of each ID (NBR_IDS entries), -1 if unused
+    int* m_scanned_models;              // Dynamixel-defined model numbers read from the motors
+    uint8_t* m_indir_address_offsets;   // Occupied indirect address registers, in bytes
+    uint8_t* m_indir_data_offsets;      // Occupied indirect data registers, in bytes
+
+    Motor_data_field* m_control_table;      // Flat control table of every model: [model*NBR_FIELDS + field]
+    Control_modes* m_controlModesPerModel;  // List of control modes values for each Dxl model
+    Position_codec* m_positionCodecsPerModel;   // Position codec of each Dxl model
+
+    Hal();
+    ~Hal();
+    Hal(const Hal&) = delete;
+    Hal& operator=(const Hal&) = delete;
+    std::vector<int> init(char* motor_config_file);
+    std::vector<int> init(char* motor_config_file, char* path_to_KMR_dxl);
+    void get_ID_list_from_motors_list();
+    Motor_data_field getControlParametersFromID(int id, Fields field) const;
+    int getMotorsListIndexFromID(int id) const;
+    Motor getMotorFromID(int id) const;
+    void updateResetStatus(int id, int status);
+    void updateScannedModel(int id, int model_number);
+    int getIndirectCapacity(int id) const;
+    int reserveIndirectData(std::span<const int> ids, int length);
+
+    /**
+     * @brief       Hot-path access to a model's control parameters for a field
+     */
+    const Motor_data_field& controlParameters(Motor_models model, Fields field) const
+        { return m_control_table[model*(int)NBR_FIELDS + field]; }
+
+    /**
+     * @brief       Access to a model's position codec
+     */
+    const Position_codec& positionCodec(Motor_models model) const { return m_positionCodecsPerModel[model]; }
+
+    /**
+     * @brief       Hot-path read of a motor's "to reset" status, from its index in the motors list
+     */
+    int resetStatusAt(int motor_idx) const { return m_reset_status[motor_idx]; }
+
+    /**
+     * @brief       Hot-path update of a motor's "to reset" status, from its index in the motors list
+     */
+    void updateResetStatusAt(int motor_idx, int status) { m_reset_status[motor_idx] = status; }
+};
+
+}
+
+
+#endif
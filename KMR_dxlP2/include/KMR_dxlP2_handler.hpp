@@ -0,0 +1,102 @@
+/**
+ ******************************************************************************
+ * @file            KMR_dxlP2_handler.hpp
+ * @brief           Header for the KMR_dxlP2_handler.cpp file.
+ ******************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ ******************************************************************************
+ */
+
+#ifndef KMR_DXLP2_HANDLER_HPP
+#define KMR_DXLP2_HANDLER_HPP
+
+#include "dynamixel_sdk/dynamixel_sdk.h"
+#include "KMR_dxlP2_hal.hpp"
+#include "KMR_dxlP2_field_traits.hpp"
+#include <cstdint>
+#include <span>
+
+namespace KMR::dxlP2
+{
+
+/**
+ * @brief       Pre-resolved info of a single handled motor for a field, built once at handler
+ * 				construction so that the reading/writing hot paths never search the Hal
+ */
+struct Motor_plan {
+	int hal_idx;			// Index of the motor in the Hal's motors list
+	float unit;				// Conversion unit between parametrized data and SI units
+	Codec_kinds codec;		// Conversion applied to the handled field
+	int multiturn;			// 1 if the motor is used in multiturn mode
+	int center;				// Position of the 0 rad angle
+	int min_position;		// Position range in joint mode
+	int max_position;
+	int reset_min;			// Multiturn positions beyond which the motor needs a reset
+	int reset_max;
+};
+
+/**
+ * @brief       Location and resolved info of a field handled by a Reader or Writer
+ */
+struct Handled_field {
+	Fields field;
+	uint16_t address;				// Address of the field in the motors' control tables
+	uint8_t offset;					// Position of the field in the bytes read/written for each motor
+	uint8_t length;					// Byte size of the field
+	std::vector<Motor_plan> plan;	// Resolved info of each handled motor for this field
+};
+
+/**
+ * @brief       Parent class, to be specialized as a Reader or Writer
+ * @details		This class is not usable by itself, it is a non-specialized sketelon inherited
+ * 				by the child classes Reader and Writer. \n
+ * 				It contains functionalities to check the viability of sync readers/writers
+ * 				that will be defined in child classes (motor compatibility). \n
+ * 				A handler of several fields accesses them with a single sync instruction:
+ * 				directly if they are contiguous in the control table, through the motors'
+ * 				indirect addresses otherwise.
+ */
+class Handler
+{
+public:
+	std::vector<int> m_ids;		// All IDs handled by this specific handler
+	Fields m_field;				// Field handled by this specific handler (first one if several)
+	std::vector<Fields> m_fields;	// All fields handled by this specific handler
+
+protected:
+	dynamixel::PacketHandler *packetHandler_;
+	dynamixel::PortHandler *portHandler_;
+	std::shared_ptr<Hal> m_hal;
+	uint16_t m_data_address = 0;		// Address where the data is written/read
+	uint16_t m_data_byte_size = 0;		// Total data byte size handled by the handler
+	bool m_isIndirectHandler = false;	// The fields are accessed through indirect addresses
+	std::vector<Handled_field> m_handled_fields;	// Handled fields, same order as m_fields
+	int m_slot_from_id[NBR_IDS];		// Index in m_ids of each handled ID, -1 if not handled
+
+	void initHandler(std::vector<Fields> list_fields, std::vector<int> ids, dynamixel::PortHandler *portHandler,
+					 dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal);
+	uint16_t getFieldAddress(Fields field);
+	uint8_t getFieldLength(Fields field);
+	void checkMotorCompatibility();
+	void setIndirectAddresses();
+	void checkIDvalidity(std::span<const int> ids);
+	void checkFieldValidity(Fields field);
+	int getFieldIndex(Fields field);
+	int getMotorIndexFromID(int id);
+	std::vector<Motor_plan> buildFieldPlan(Fields field);
+
+	// Methods that need to be implemented in child classes
+	virtual void clearParam() = 0; // Pure Virtual Function
+
+public:
+	virtual ~Handler() = default;
+};
+
+} // namespace KMR::dxlP2
+
+#endif
@@ -0,0 +1,98 @@
+/**
+ ******************************************************************************
+ * @file            KMR_dxlP2_reader.hpp
+ * @brief           Header for the KMR_dxlP2_reader.cpp file.
+ ******************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ ******************************************************************************
+ */
+
+#ifndef KMR_DXLP2_READER_HPP
+#define KMR_DXLP2_READER_HPP
+
+#include "KMR_dxlP2_handler.hpp"
+
+namespace KMR::dxlP2
+{
+
+/**
+ * @brief       Custom Reader class, reading fields with protocol 2 sync read instructions
+ * @details 	This custom Reader class simplifies greatly the creation of dynamixel reading handlers. \n
+ * 				It takes care automatically of address assignment, even for indirect address handling. \n
+ * 				All handled fields are read with a single sync read: the motors reply one after
+ * 				the other. Fast sync read (enableFastSyncRead) gathers all the replies in a single
+ * 				status packet instead, saving the headers and the return delays of all but one motor. \n
+ * 				Only the first handled field is converted to SI units with each read: the other ones
+ * 				are converted when accessed (getFieldData). \n
+ * 				Motors that did not reply keep their last valid values: isValid tells which
+ * 				values come from the last read.
+ */
+class Reader : public Handler
+{
+protected:
+	dynamixel::GroupSyncRead *m_groupSyncReader;
+	dynamixel::GroupFastSyncRead *m_groupFastSyncReader = nullptr;
+	bool m_fastSyncRead = false;	// The motors are read with fast sync read instructions
+
+	uint8_t *m_received;		// 1 if a valid reply was received from a motor during the last read
+	int32_t *m_rawPerField;		// Parametrized values of each field, [field index * nbr motors + motor index]
+	uint8_t *m_decoded;			// 1 if m_dataPerField holds a field's values of the last read, [field index]
+
+	void clearParam();
+	void checkReadSuccessful(std::span<const int> ids);
+	void populateOutputMatrix(std::span<const int> ids);
+	uint32_t getData(int id, const Handled_field& handled_field);
+	void decodeField(int field_idx);
+
+	template <typename GroupRead>
+	int sendReadRequest(GroupRead *groupReader, std::span<const int> ids);
+
+public:
+	float *m_dataFromMotor;  // Table holding the read values from motors (first handled field)
+	float **m_dataPerField;  // Read values of each handled field, [field index][motor index],
+							 // converted on access by getFieldData except for the first field
+
+	Reader(Fields field, std::vector<int> ids,
+			dynamixel::PortHandler *portHandler,
+			dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal);
+	Reader(std::vector<Fields> list_fields, std::vector<int> ids,
+			dynamixel::PortHandler *portHandler,
+			dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal);
+	~Reader();
+	void enableFastSyncRead(bool enable = true);
+	void syncRead(std::span<const int> ids);
+	float* getFieldData(Fields field);
+	int32_t getRawValue(Fields field, int id);
+	bool isValid(int id);
+};
+
+
+/**
+ * @brief       Send a read instruction to input motors and wait for their replies
+ * @param[in]   groupReader Sync read or fast sync read group of the reader
+ * @param[in]   ids List of motors whose fields will be read
+ * @retval      Communication result of the read
+ */
+template <typename GroupRead>
+int Reader::sendReadRequest(GroupRead *groupReader, std::span<const int> ids)
+{
+	groupReader->clearParam();
+
+	for (int i=0; i<ids.size(); i++) {
+		if (!groupReader->addParam((uint8_t)ids[i])) {
+			std::cout << "[KMR::dxlP2::Reader] Adding parameters failed for ID = " << ids[i] << std::endl;
+			exit(1);
+		}
+	}
+
+	return groupReader->txRxPacket();
+}
+
+} // namespace KMR::dxlP2
+
+#endif
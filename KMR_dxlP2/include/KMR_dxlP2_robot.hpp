@@ -0,0 +1,62 @@
+/**
+ ******************************************************************************
+ * @file            KMR_dxlP2_robot.hpp
+ * @brief           Header for the KMR_dxlP2_robot.cpp file.
+ ******************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ ******************************************************************************
+ */
+
+#ifndef KMR_DXLP2_ROBOT_HPP
+#define KMR_DXLP2_ROBOT_HPP
+
+#include "KMR_dxlP2_writer.hpp"
+#include "KMR_dxlP2_reader.hpp"
+
+namespace KMR::dxlP2
+{
+
+/**
+ * @brief   Class that defines a base robot, to be inherited by a robot class in the project
+ * @details This class contains base necessities for handling a robot with protocol 2 dynamixel motors. \n
+ *          It provides functions to enable/disable motors, as well as to reset motors in multiturn. \n
+ *          At startup, the motors are set to position or extended position mode, as declared in
+ *          the configuration file. \n
+ *          The user needs to create handlers they need (Writers and Readers) for their specific
+ *          application, as well as their respective reading/writing functions. \n
+ *          NB: handlers mapping their fields to indirect addresses are to be created before
+ *          the motors are enabled
+ */
+class BaseRobot {
+    protected:
+        dynamixel::PortHandler   *portHandler_;
+        dynamixel::PacketHandler *packetHandler_;
+
+        Writer *m_motor_enabler;
+        Writer *m_mode_writer;
+
+        void init_comm(const char *port_name, int baudrate, float protocol_version);
+        void check_comm();
+        void setOperatingModes(std::span<const int> ids, bool multiturn);
+
+    public:
+        std::shared_ptr<Hal> m_hal;  // to put private? @todo
+        std::vector<int> m_all_IDs; // All motor IDs in the robot
+
+        BaseRobot(std::vector<int> all_ids, const char *port_name, int baudrate, std::shared_ptr<Hal> hal);
+        ~BaseRobot();
+
+        void enableMotors();
+        void enableMotors(std::span<const int> ids);
+        void disableMotors();
+        void disableMotors(std::span<const int> ids);
+        void resetMultiturnMotors(int sleep_time_us);
+};
+
+}
+#endif
@@ -0,0 +1,131 @@
+/**
+ ******************************************************************************
+ * @file            KMR_dxlP2_writer.hpp
+ * @brief           Header for the KMR_dxlP2_writer.cpp file.
+ ******************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ ******************************************************************************
+ */
+
+#ifndef KMR_DXLP2_WRITER_HPP
+#define KMR_DXLP2_WRITER_HPP
+
+#include <cmath>
+#include <cstdint>
+#include "KMR_dxlP2_handler.hpp"
+
+namespace KMR::dxlP2
+{
+
+/**
+ * @brief       Custom Writer class that contains a dynamixel::GroupSyncWrite object
+ * @details 	This custom Writer class simplifies greatly the creation of dynamixel writing handlers. \n
+ * 				It takes care automatically of address assignment, even for indirect address handling. \n
+ * 				All handled fields of a motor are packed into a single payload, so that they are
+ * 				sent with one sync write.
+ */
+class Writer : public Handler
+{
+protected:
+    dynamixel::GroupSyncWrite *m_groupSyncWriter;
+    uint8_t **m_dataParam; // Table containing all parametrized data to be sent next step
+
+    int limitPosition(int position, const Motor_plan& plan);
+    void bindParameter(int lower_bound, int upper_bound, int &param);
+    void populateDataParam(int32_t data, int motor_idx, int field_offset, int field_length);
+    void clearParam();
+    bool addParam(uint8_t id, uint8_t* data);
+    bool multiturnOverLimit(int position, const Motor_plan& plan);
+
+public:
+    Writer(Fields field, std::vector<int> ids, dynamixel::PortHandler *portHandler,
+            dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal);
+    Writer(std::vector<Fields> list_fields, std::vector<int> ids, dynamixel::PortHandler *portHandler,
+            dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal);
+    ~Writer();
+    template <typename T>
+    void addDataToWrite(const std::vector<T>& data, const std::vector<int>& ids);
+    template <typename T>
+    void addDataToWrite(const std::vector<T>& data, Fields field, const std::vector<int>& ids);
+    template <typename T>
+    void addDataToWrite(std::span<const T> data, Fields field, std::span<const int> ids);
+    void syncWrite();
+    void syncWrite(std::span<const int> ids);
+};
+
+// Templates need to be defined in hpp
+
+/**
+ * @brief       Add data to the list to be sent later with syncWrite, for the first handled field
+ * @param[in]   data Data to be sent to motors (eg, new goal positions), in SI units. \n
+ *              NB: If only one value is input, it will be sent to all input motors
+ * @param[in]   ids List of motors that will receive the data
+ * @retval      void
+ */
+template <typename T>
+void Writer::addDataToWrite(const std::vector<T>& data, const std::vector<int>& ids)
+{
+    addDataToWrite(std::span<const T>(data), m_field, std::span<const int>(ids));
+}
+
+/**
+ * @brief       Add data to the list to be sent later with syncWrite
+ * @param[in]   data Data to be sent to motors (eg, new goal positions), in SI units. \n
+ *              NB: If only one value is input, it will be sent to all input motors
+ * @param[in]   field Control field to receive the data
+ * @param[in]   ids List of motors that will receive the data
+ * @retval      void
+ */
+template <typename T>
+void Writer::addDataToWrite(const std::vector<T>& data, Fields field, const std::vector<int>& ids)
+{
+    addDataToWrite(std::span<const T>(data), field, std::span<const int>(ids));
+}
+
+/**
+ * @brief       Add data to the list to be sent later with syncWrite, without heap allocation
+ * @param[in]   data Data to be sent to motors (eg, new goal positions), in SI units. \n
+ *              NB: If only one value is input, it will be sent to all input motors
+ * @param[in]   field Control field to receive the data
+ * @param[in]   ids List of motors that will receive the data
+ * @retval      void
+ */
+template <typename T>
+void Writer::addDataToWrite(std::span<const T> data, Fields field, std::span<const int> ids)
+{
+    int field_idx = getFieldIndex(field);
+    const Handled_field& handled_field = m_handled_fields[field_idx];
+    int param_data;
+    int motor_idx;
+
+    checkIDvalidity(ids);
+    if (data.size() != 1 && data.size() != ids.size()) {
+        std::cout << "[KMR::dxlP2::Writer] One value, or one value per motor, is needed!" << std::endl;
+        exit(1);
+    }
+
+    for (int i=0; i<ids.size(); i++) {
+        motor_idx = getMotorIndexFromID(ids[i]);
+        const Motor_plan& plan = handled_field.plan[motor_idx];
+        float value = (data.size() == 1) ? data[0] : data[i];
+
+        // Transform data into its parametrized form
+        if (plan.codec == ANGLE_CODEC) {
+            param_data = (int) std::lround(value / plan.unit) + plan.center;
+            param_data = limitPosition(param_data, plan);
+        }
+        else
+            param_data = (int) std::lround(value / plan.unit);
+
+        populateDataParam(param_data, motor_idx, handled_field.offset, handled_field.length);
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,738 @@
+/**
+ ******************************************************************************
+ * @file            KMR_dxlP2_hal.cpp
+ * @brief           Defines the Hal class
+ ******************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT  
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ ******************************************************************************
+ */
+
+#include "KMR_dxlP2_hal.hpp"
+#include "KMR_dxlP2_control_tables.hpp"     // Generated at build time from config/motor_models
+#include "yaml-cpp/yaml.h"
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+using namespace std;
+
+
+namespace YAML
+{
+
+/**
+ * @brief       Overload YAML::Node.as to be usable with our Data_node structure: \n
+ *              Convert YAML::Node to Data_node
+ * @param[in]   node YAML:Node read by the YAML parser
+ * @param[out]  data_node Instance of Data_node to store the info gotten from node
+ * @retval      void
+ */
+template <>
+struct convert<KMR::dxlP2::Data_node>
+{
+
+    static bool decode(const Node &node, KMR::dxlP2::Data_node &data_node)
+    {
+
+        data_node.field_name = node["field"].as<std::string>();
+        data_node.address = node["address"].as<int>();
+        data_node.length = node["length"].as<int>();
+        data_node.unit = node["unit"].as<float>();
+
+        return true;
+    }
+};
+
+/**
+ * @brief       Overload YAML::Node.as to be usable with our Motor_node structure: \n
+ *              Convert YAML::Node to Motor_node
+ * @param[in]   node YAML:Node read by the YAML parser
+ * @param[out]  motor_node Instance of Motor_node to store the info gotten from node
+ * @retval      void
+ */
+template <>
+struct convert<KMR::dxlP2::Motor_node>
+{
+
+    static bool decode(const Node &node, KMR::dxlP2::Motor_node &motor_node)
+    {
+        motor_node.id = node["ID"].as<int>();
+        motor_node.model_name = node["model"].as<string>();
+        motor_node.multiturn = node["multiturn"].as<int>();
+        return true;
+    }
+};
+
+
+/**
+ * @brief       Overload YAML::Node.as to be usable with our Control_modes structure: \n
+ *              Convert YAML::Node to Control_modes
+ * @param[in]   node YAML:Node read by the YAML parser
+ * @param[out]  motor_node Instance of Control_modes to contain the info gotten from node
+ * @retval      void
+ */
+template <>
+struct convert<KMR::dxlP2::Control_modes>
+{
+
+    static bool decode(const Node &node, KMR::dxlP2::Control_modes &control_modes)
+    {
+
+        control_modes.current_control = (uint8_t) node["current_control"].as<int>();
+        control_modes.current_based_position_control = (uint8_t) node["current_based_position_control"].as<int>();
+        control_modes.multiturn_control = (uint8_t) node["multiturn_control"].as<int>();
+        control_modes.velocity_control = (uint8_t) node["velocity_control"].as<int>();
+        control_modes.position_control = (uint8_t) node["position_control"].as<int>();
+        control_modes.PWM_control = (uint8_t) node["PWM_control"].as<int>();
+
+        return true;
+    }
+};
+
+/**
+ * @brief       Overload YAML::Node.as to be usable with our Position_codec structure: \n
+ *              Convert YAML::Node to Position_codec
+ * @param[in]   node YAML:Node read by the YAML parser
+ * @param[out]  position_codec Instance of Position_codec to contain the info gotten from node
+ * @retval      void
+ */
+template <>
+struct convert<KMR::dxlP2::Position_codec>
+{
+
+    static bool decode(const Node &node, KMR::dxlP2::Position_codec &position_codec)
+    {
+        position_codec.resolution = node["resolution"].as<int>();
+        position_codec.center = node["center"].as<int>();
+        position_codec.min_position = node["min_position"].as<int>();
+        position_codec.max_position = node["max_position"].as<int>();
+        position_codec.multiturn_min = node["multiturn_min"].as<int>();
+        position_codec.multiturn_max = node["multiturn_max"].as<int>();
+
+        return true;
+    }
+};
+
+}
+
+namespace KMR::dxlP2
+{
+
+/**
+ * @brief       Constructor for Hal
+ */
+Hal::Hal()
+{
+    m_tot_nbr_motors = -1;
+    m_storage = nullptr;
+    m_storage_size = 0;
+}
+
+/**
+ * @brief       Initialize the hal: parse motor config file and load the control tables 
+ *              compiled into the library. To call immediately after the constructor   
+ * @param[in]   motor_config_file Configuration file of the motors in the project
+ * @return      Vector of all motor IDs 
+ */
+vector<int> Hal::init(char *motor_config_file)
+{
+    return init(motor_config_file, nullptr);
+}
+
+/**
+ * @brief       Initialize the hal: parse motor config file and create the control table. 
+ *              To call immediately after the constructor   
+ * @param[in]   motor_config_file Configuration file of the motors in the project
+ * @param[in]   path_to_KMR_dxl Path from the working directory (build) to this library's folder. \n 
+ *              If not null, the control tables are re-read from the motor models' yaml files 
+ *              instead of using the compiled ones
+ * @return      Vector of all motor IDs 
+ */
+vector<int> Hal::init(char *motor_config_file, char* path_to_KMR_dxl)
+{
+    // Parse the motor config specific to the current project
+    parse_motor_config(motor_config_file);
+
+    // Allocate the motors' arrays and the control table, then save the parsed motors
+    allocate_storage(m_tot_nbr_motors);
+    for (int i = 0; i < NBR_IDS; i++)
+        m_idx_from_id[i] = -1;
+    for (int i = 0; i < m_tot_nbr_motors; i++) {
+        if (m_parsed_motors[i].id < 0 || m_parsed_motors[i].id >= NBR_IDS) {
+            cout << "[KMR::dxl] Motor ID " << m_parsed_motors[i].id << " is out of range!" << endl;
+            exit(1);
+        }
+        m_motor_ids[i] = m_parsed_motors[i].id;
+        m_motor_models[i] = m_parsed_motors[i].model;
+        m_multiturn[i] = m_parsed_motors[i].multiturn;
+        m_idx_from_id[m_motor_ids[i]] = i;
+    }
+    m_parsed_motors.clear();
+
+    // Create the control table for all models
+    if (path_to_KMR_dxl == nullptr)
+        load_compiled_control_table();
+    else
+        populate_control_table(path_to_KMR_dxl);
+
+    // Extract the list of motor IDs
+    get_ID_list_from_motors_list();
+
+    return m_all_IDs;
+}
+
+
+/**
+ * @brief       Destructor for Hal
+ */
+Hal::~Hal()
+{
+    // cout << "[KMR::dxl] The Hal object is being deleted" << endl;
+    free(m_storage);
+}
+
+
+/**
+ * @brief       Reserve a sub-array in the Hal's single storage allocation
+ * @param[in]   offset Current end of the storage layout, updated
+ * @param[in]   bytes Size of the sub-array
+ * @param[in]   alignment Alignment of the sub-array's elements
+ * @retval      Offset of the sub-array from the start of the storage
+ */
+static size_t reserve(size_t& offset, size_t bytes, size_t alignment)
+{
+    size_t start = (offset + alignment - 1) / alignment * alignment;
+    offset = start + bytes;
+    return start;
+}
+
+/**
+ * @brief       Allocate, in a single zeroed block, the motors' arrays and the flat control table
+ * @note        The hot per-cycle arrays come first so that they share as few cache lines as possible
+ * @param[in]   nbr_motors Number of motors in the robot
+ * @retval      void
+ */
+void Hal::allocate_storage(int nbr_motors)
+{
+    size_t offset = 0;
+    size_t ids_at = reserve(offset, nbr_motors * sizeof(int), alignof(int));
+    size_t reset_at = reserve(offset, nbr_motors * sizeof(int), alignof(int));
+    size_t multiturn_at = reserve(offset, nbr_motors * sizeof(int), alignof(int));
+    size_t models_at = reserve(offset, nbr_motors * sizeof(Motor_models), alignof(Motor_models));
+    size_t idx_at = reserve(offset, NBR_IDS * sizeof(int16_t), alignof(int16_t));
+    size_t table_at = reserve(offset, (size_t)NBR_MODELS * NBR_FIELDS * sizeof(Motor_data_field), alignof(Motor_data_field));
+    size_t modes_at = reserve(offset, NBR_MODELS * sizeof(Control_modes), alignof(Control_modes));
+    size_t codecs_at = reserve(offset, NBR_MODELS * sizeof(Position_codec), alignof(Position_codec));
+    size_t scanned_at = reserve(offset, nbr_motors * sizeof(int), alignof(int));
+    size_t indir_addr_at = reserve(offset, nbr_motors * sizeof(uint8_t), alignof(uint8_t));
+    size_t indir_data_at = reserve(offset, nbr_motors * sizeof(uint8_t), alignof(uint8_t));
+
+    free(m_storage);
+    m_storage_size = offset;
+    m_storage = (uint8_t *)calloc(1, m_storage_size);
+
+    m_motor_ids = (int *)(m_storage + ids_at);
+    m_reset_status = (int *)(m_storage + reset_at);
+    m_multiturn = (int *)(m_storage + multiturn_at);
+    m_motor_models = (Motor_models *)(m_storage + models_at);
+    m_idx_from_id = (int16_t *)(m_storage + idx_at);
+    m_control_table = (Motor_data_field *)(m_storage + table_at);
+    m_controlModesPerModel = (Control_modes *)(m_storage + modes_at);
+    m_positionCodecsPerModel = (Position_codec *)(m_storage + codecs_at);
+    m_scanned_models = (int *)(m_storage + scanned_at);
+    m_indir_address_offsets = m_storage + indir_addr_at;
+    m_indir_data_offsets = m_storage + indir_data_at;
+}
+
+
+/*****************************************************************************
+ *                   Creation of the control table
+ ****************************************************************************/
+
+/**
+ * @brief       Populate the control table and control modes of all models from the tables 
+ *              generated at build time: no file is opened nor parsed
+ * @retval      void
+ */
+void Hal::load_compiled_control_table()
+{
+    for (int model = 0; model < NBR_MODELS; model++)
+    {
+        for (int field = 0; field < NBR_FIELDS; field++)
+            m_control_table[model*(int)NBR_FIELDS + field] = CONTROL_TABLES[model][field];
+
+        m_controlModesPerModel[model] = CONTROL_MODES[model];
+        m_positionCodecsPerModel[model] = POSITION_CODECS[model];
+    }
+}
+
+/**
+ * @brief       Populate the control table's data fields for all motor models in the project, 
+ *              by parsing their yaml files at runtime. Overrides the compiled control tables
+ * @param[in]   path_to_KMR_dxl Path from the working directory (build) to this library's folder
+ * @retval      void
+ */
+void Hal::populate_control_table(char* path_to_KMR_dxl)
+{
+    Data_node data_node;
+    Motor_data_field motor_data_field;
+    Fields col;
+
+    // For each motor model, open its config file and populate the control table
+    for (int i = 0; i < m_unique_motor_models_list.size(); i++)
+    {
+        string config_file = (string)path_to_KMR_dxl + (string)"/config/motor_models/"
+                             + m_unique_motor_models_list[i];
+
+        // Open the yaml config file
+        YAML::Node config = YAML::LoadFile(config_file);
+        cout << "[KMR::dxl] Motor model file open: " << config_file << endl;
+
+        // Read and convert the first line to get the motor model name
+        string motor_model_string = config["model_name"].as<string>();
+        Motor_models motor_model = string2Motors_models(motor_model_string);
+        if (motor_model == UNDEF_M) {
+            cout << "[KMR::dxl] Model " << motor_model_string << " is not compiled into the library, rebuild it!" << endl;
+            exit(1);
+        }
+
+        // Read the values to set control modes
+        Control_modes control_modes = config["operating_modes"][0].as<Control_modes>();
+        m_controlModesPerModel[motor_model] = control_modes;
+
+        // Read the model's position encoding
+        m_positionCodecsPerModel[motor_model] = config["position_codec"][0].as<Position_codec>();
+
+        // Read the motor_data nodes: get the name, address, length and unit of each data field
+        for (int j = 0; j < config["motor_data"].size(); j++)
+        {
+            data_node = config["motor_data"][j].as<Data_node>();
+
+            // Convert the read node into our structures
+            col = string2Fields(data_node.field_name);
+            if (col == UNDEF_F) {
+                cout << "[KMR::dxl] Unknown field " << data_node.field_name << " in " << config_file << endl;
+                exit(1);
+            }
+            dataNode2Motor_data_field(data_node, motor_data_field);
+
+            // Populate the control table
+            m_control_table[motor_model*(int)NBR_FIELDS + col] = motor_data_field;
+        }
+    }
+
+}
+
+/*****************************************************************************
+ *          Conversions from nodes/strings to our structures/enumerates
+ ****************************************************************************/
+
+/**
+ * @brief       Convert a string to Motors_models enumerate
+ * @note        The model names are generated at build time from config/motor_models
+ * @param[in]   str String to be converted into the enumerate value
+ * @retval      Motors_models enumerate value
+ */
+Motor_models Hal::string2Motors_models(const string &str)
+{
+    for (int i = 0; i < NBR_MODELS; i++) {
+        if (str == MOTOR_MODEL_NAMES[i])
+            return (Motor_models) i;
+    }
+
+    return UNDEF_M;
+}
+
+/**
+ * @brief       Convert a string to Fields enumerate
+ * @param[in]   str String to be converted into the enumerate value
+ * @retval      Fields enumerate value
+ */
+Fields Hal::string2Fields(const string &str)
+{
+    //EEPROM
+    if (str == "MODEL_NBR")
+        return MODEL_NBR;
+    else if (str == "MODEL_INFO")
+        return MODEL_INFO;
+    else if (str == "FIRMWARE")
+        return FIRMWARE;
+    else if (str == "ID")
+        return ID;
+    else if (str == "BAUDRATE")
+        return BAUDRATE;
+    else if (str == "RETURN_DELAY")
+        return RETURN_DELAY;
+    else if (str == "DRIVE_MODE")
+        return DRIVE_MODE;
+    else if (str == "OPERATING_MODE")
+        return OPERATING_MODE;
+    else if (str == "SHADOW_ID")
+        return SHADOW_ID;
+    else if (str == "PROTOCOL")
+        return PROTOCOL;
+    else if (str == "HOMING_OFFSET")
+        return HOMING_OFFSET;
+    else if (str == "MOVING_THRESHOLD")
+        return MOVING_THRESHOLD;
+    else if (str == "TEMP_LIMIT")
+        return TEMP_LIMIT;
+    else if (str == "MAX_VOLT_LIMIT")
+        return MAX_VOLT_LIMIT;
+    else if (str == "MIN_VOLT_LIMIT")
+        return MIN_VOLT_LIMIT;
+    else if (str == "PWM_LIMIT")
+        return PWM_LIMIT;
+    else if (str == "CURRENT_LIMIT")
+        return CURRENT_LIMIT;
+    else if (str == "ACC_LIMIT")
+        return ACC_LIMIT;
+    else if (str == "VEL_LIMIT")
+        return VEL_LIMIT;
+    else if (str == "MAX_POS_LIMIT")
+        return MAX_POS_LIMIT;
+    else if (str == "MIN_POS_LIMIT")
+        return MIN_POS_LIMIT;
+    else if (str == "SHUTDOWN")
+        return SHUTDOWN;
+    // RAM    
+    else if (str == "TRQ_ENABLE")
+        return TRQ_ENABLE;
+    else if (str == "LED")
+        return LED;
+    else if (str == "STATUS_RETURN")
+        return STATUS_RETURN;
+    else if (str == "REGISTERED")
+        return REGISTERED;
+    else if (str == "HW_ERROR")
+        return HW_ERROR;
+    else if (str == "VEL_I_GAIN")
+        return VEL_I_GAIN;
+    else if (str == "VEL_P_GAIN")
+        return VEL_P_GAIN;
+    else if (str == "POS_D_GAIN")
+        return POS_D_GAIN;
+    else if (str == "POS_I_GAIN")
+        return POS_I_GAIN;
+    else if (str == "POS_P_GAIN")
+        return POS_P_GAIN;
+    else if (str == "FF_ACC_GAIN")
+        return FF_ACC_GAIN;
+    else if (str == "FF_VEL_GAIN")
+        return FF_VEL_GAIN;
+    else if (str == "BUS_WATCHDOG")
+        return BUS_WATCHDOG;
+    else if (str == "GOAL_PWM")
+        return GOAL_PWM;
+    else if (str == "GOAL_CURRENT")
+        return GOAL_CURRENT;
+    else if (str == "GOAL_VEL")
+        return GOAL_VEL;
+    else if (str == "PROFILE_ACC")
+        return PROFILE_ACC;
+    else if (str == "PROFILE_VEL")
+        return PROFILE_VEL;
+    else if (str == "GOAL_POS")
+        return GOAL_POS;
+    else if (str == "REALTIME_TICK")
+        return REALTIME_TICK;
+    else if (str == "MOVING")
+        return MOVING;
+    else if (str == "MOVING_STATUS")
+        return MOVING_STATUS;
+    else if (str == "PRESENT_PWM")
+        return PRESENT_PWM;
+    else if (str == "PRESENT_CURRENT")
+        return PRESENT_CURRENT;
+    else if (str == "PRESENT_VEL")
+        return PRESENT_VEL;
+    else if (str == "PRESENT_POS")
+        return PRESENT_POS;
+    else if (str == "VEL_TRAJECTORY")
+        return VEL_TRAJECTORY;
+    else if (str == "POS_TRAJECTORY")
+        return POS_TRAJECTORY;
+    else if (str == "PRESENT_VOLT")
+        return PRESENT_VOLT;
+    else if (str == "PRESENT_TEMP")
+        return PRESENT_TEMP;
+    else if (str == "INDIR_ADDRESS_1")
+        return INDIR_ADDRESS_1;
+    else if (str == "INDIR_DATA_1")
+        return INDIR_DATA_1;
+    else
+        return UNDEF_F;
+}
+
+/**
+ * @brief       Convert a Data_node instance to a Motor_data_field instance
+ * @param[in]   data_node Data_node instance to be converted
+ * @param[out]  motor_data_field Motor_data_field instance to store the info from the node
+ * @retval      void
+ */
+void Hal::dataNode2Motor_data_field(Data_node &data_node, Motor_data_field &motor_data_field)
+{
+    motor_data_field.address = (std::uint16_t)data_node.address;
+    motor_data_field.length = (std::uint8_t)data_node.length;
+    motor_data_field.unit = data_node.unit;
+}
+
+/**
+ * @brief       Convert a Motor_node instance to a Motor instance
+ * @param[in]   motor_node Motor_node instance to be converted
+ * @param[out]  motor Motor instance to store the info from the node
+ * @retval      void
+ */
+void Hal::motorNode2Motor(Motor_node &motor_node, Motor &motor)
+{
+    motor.id = motor_node.id;
+    motor.model = string2Motors_models(motor_node.model_name);
+    motor.multiturn = motor_node.multiturn;
+}
+
+
+/*****************************************************************************
+ *                Parsing of project-specific config files
+ ****************************************************************************/
+
+/**
+ * @brief       Parse the motor configuration file and populate the list of motors
+ * @param[in]   config_file Yaml config file for the motors in the robot
+ * @return      void
+ */
+void Hal::parse_motor_config(char *config_file)
+{
+    Motor_node motor_node;
+    Motor motor;
+
+    // Open the yaml config file
+    YAML::Node config = YAML::LoadFile(config_file);
+    cout << "[KMR::dxl] Project motor config file open: " << config_file << endl;
+
+    // Read and convert the first line to get the number of motors in the robot
+    m_tot_nbr_motors = config["nbr_motors"].as<int>();
+    if (m_tot_nbr_motors != config["motors"].size()) {
+        cout << "[KMR::dxl] ERROR in the number of motors in the config file!!" << endl;
+        exit(1);
+    }
+
+    // The motors are kept aside until the storage is allocated
+    m_parsed_motors = vector<Motor>(m_tot_nbr_motors);
+
+    // Read the motors nodes: get the ID, model and multiturn mode for each motor
+    for (int i = 0; i < config["motors"].size(); i++)
+    {
+        motor_node = config["motors"][i].as<Motor_node>();
+
+        // Convert the read node and update the list of used models
+        motorNode2Motor(motor_node, motor);
+        if (motor.model == UNDEF_M) {
+            cout << "[KMR::dxl] Motor " << motor.id << ": unknown model " << motor_node.model_name << endl;
+            exit(1);
+        }
+        update_unique_models_list(motor_node.model_name);
+
+        // Populate the list of motors
+        m_parsed_motors[i] = motor;
+    }
+}
+
+/**
+ * @brief       Create the list of unique motor models used in the robot
+ * @param[in]   motor_model_string Model of the currently querried motor
+ * @retval      void
+ */
+void Hal::update_unique_models_list(string motor_model_string)
+{
+    string filename = motor_model_string + (string) ".yaml";
+    bool model_in_list = false;
+
+    for (int i = 0; i < m_unique_motor_models_list.size(); i++)
+    {
+        if (m_unique_motor_models_list[i] == filename)
+        {
+            model_in_list = true;
+            break;
+        }
+    }
+
+    if (model_in_list == false)
+        m_unique_motor_models_list.push_back(filename);
+}
+
+
+
+/**
+ * @brief       Extract the list of all motor IDs from the motors list
+ * @return      void
+ */
+void Hal::get_ID_list_from_motors_list()
+{
+    m_all_IDs = vector<int> (m_tot_nbr_motors);
+
+    for (int i = 0; i < m_tot_nbr_motors; i++)
+        m_all_IDs[i] = m_motor_ids[i];
+}
+
+
+/*****************************************************************************
+ *                     Query functions from outside
+ ****************************************************************************/
+
+/**
+ * @brief       Get control parameters of a specific control field from motor ID
+ * @note        Vital function
+ * @param[in]   id ID of the query motor
+ * @param[in]   field Control field of the query
+ * @retval      Control parameters of the query field
+ */
+Motor_data_field Hal::getControlParametersFromID(int id, Fields field) const
+{
+    Motor_models model = getModelFromID(id);
+    if (model == UNDEF_M) {
+        cout << "[KMR::dxl] Motor " << id << " is not in the motors config file!" << endl;
+        exit(1);
+    }
+    Motor_data_field params = controlParameters(model, field);
+
+    return params;
+}
+
+/**
+ * @brief       Get motor model from motor ID
+ * @param[in]   id ID of the query motor
+ * @retval      Model of the query motor
+ */
+Motor_models Hal::getModelFromID(int id) const
+{
+    int idx = getMotorsListIndexFromID(id);
+    if (idx == m_tot_nbr_motors)
+        return UNDEF_M;
+
+    return m_motor_models[idx];
+}
+
+/**
+ * @brief       Get a motor's list index from its ID
+ * @param[in]   id ID of the query motor
+ * @retval      Index of the query motor, m_tot_nbr_motors if the motor is unknown
+ */
+int Hal::getMotorsListIndexFromID(int id) const
+{
+    if (id < 0 || id >= NBR_IDS || m_idx_from_id[id] == -1)
+        return m_tot_nbr_motors;
+
+    return m_idx_from_id[id];
+}
+
+/**
+ * @brief       Get a motor's info structure from motor ID
+ * @param[in]   id ID of the query motor
+ * @retval      Copy of the query motor's info, assembled from the Hal's arrays
+ */
+Motor Hal::getMotorFromID(int id) const
+{
+    int idx = getMotorsListIndexFromID(id);
+    Motor motor;
+
+    motor.id = m_motor_ids[idx];
+    motor.model = m_motor_models[idx];
+    motor.multiturn = m_multiturn[idx];
+    motor.control_modes = m_controlModesPerModel[motor.model];
+    motor.indir_address_offset = m_indir_address_offsets[idx];
+    motor.indir_data_offset = m_indir_data_offsets[idx];
+    motor.scanned_model = m_scanned_models[idx];
+    motor.toReset = m_reset_status[idx];
+
+    return motor;
+}
+
+
+/*****************************************************************************
+ *                             Misc. functions
+ ****************************************************************************/
+
+/**
+ * @brief       Update a motor's "to reset" status in multiturn mode
+ * @param[in]   id ID of the query motor
+ * @param[in]   status Boolean: 1 if need to reset, 0 if not
+ * @retval      void
+ */
+void Hal::updateResetStatus(int id, int status)
+{
+    int idx = getMotorsListIndexFromID(id);
+    m_reset_status[idx] = status;
+}
+
+/**
+ * @brief       Save the model number read from a motor during the communication check
+ * @param[in]   id ID of the query motor
+ * @param[in]   model_number Dynamixel-defined model number returned by the motor
+ * @retval      void
+ */
+void Hal::updateScannedModel(int id, int model_number)
+{
+    int idx = getMotorsListIndexFromID(id);
+    m_scanned_models[idx] = model_number;
+}
+
+/**
+ * @brief       Get the number of indirect data registers of a motor, ie the maximal byte size of 
+ *              the fields that the handlers can map to them
+ * @param[in]   id ID of the query motor
+ * @retval      Number of indirect data registers, 0 if the model has none
+ */
+int Hal::getIndirectCapacity(int id) const
+{
+    Motor_data_field indir_address = getControlParametersFromID(id, INDIR_ADDRESS_1);
+    Motor_data_field indir_data = getControlParametersFromID(id, INDIR_DATA_1);
+
+    if (indir_address.length == 0 || indir_data.length == 0)
+        return 0;
+
+    // Each indirect address register (2 bytes) maps one indirect data register
+    return (indir_data.address - indir_address.address) / indir_address.length;
+}
+
+/**
+ * @brief       Reserve indirect data registers to a handler, at the same offset on all its motors 
+ *              so that they can be read/written with a single sync instruction
+ * @param[in]   ids Motors handled by the handler
+ * @param[in]   length Number of registers (bytes) to be reserved
+ * @retval      Offset of the reserved registers from INDIR_DATA_1, in bytes
+ */
+int Hal::reserveIndirectData(std::span<const int> ids, int length)
+{
+    int offset = 0;
+    int idx;
+
+    // First offset free on all motors
+    for (int i = 0; i < ids.size(); i++) {
+        idx = getMotorsListIndexFromID(ids[i]);
+        offset = max(offset, (int) m_indir_data_offsets[idx]);
+    }
+
+    for (int i = 0; i < ids.size(); i++) {
+        if (offset + length > getIndirectCapacity(ids[i])) {
+            cout << "[KMR::dxl] Not enough indirect addresses left in motor " << ids[i] << "!" << endl;
+            exit(1);
+        }
+
+        idx = getMotorsListIndexFromID(ids[i]);
+        m_indir_data_offsets[idx] = offset + length;
+        m_indir_address_offsets[idx] = 2 * (offset + length);
+    }
+
+    return offset;
+}
+
+
+}
@@ -0,0 +1,285 @@
+/**
+ ******************************************************************************
+ * @file            KMR_dxlP2_handler.cpp
+ * @brief           Defines the Handler class
+ ******************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ ******************************************************************************
+ */
+
+#include "KMR_dxlP2_handler.hpp"
+#include <algorithm>
+#include <cstdint>
+
+
+using std::cout;
+using std::endl;
+using std::vector;
+
+
+namespace KMR::dxlP2
+{
+
+
+/*
+ *****************************************************************************
+ *                                Initializations
+ ****************************************************************************/
+
+/**
+ * @brief       Initialize the members common to all handlers: check the motors' compatibility,
+ *              locate the handled fields (through indirect addresses if needed) and resolve
+ *              the info of each handled motor
+ * @param[in]   list_fields List of fields to be handled
+ * @param[in]   ids Motors to be handled
+ * @param[in]   portHandler Object handling port communication
+ * @param[in]   packetHandler Object handling packets
+ * @param[in]   hal Previously initialized Hal object, shared by all handlers
+ * @retval      void
+ */
+void Handler::initHandler(vector<Fields> list_fields, vector<int> ids, dynamixel::PortHandler *portHandler,
+                          dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal)
+{
+    m_hal = hal;
+    m_ids = ids;
+    m_fields = list_fields;
+    m_field = list_fields[0];
+    portHandler_ = portHandler;
+    packetHandler_ = packetHandler;
+
+    for (int i=0; i<NBR_IDS; i++)
+        m_slot_from_id[i] = -1;
+
+    for (int i=0; i<m_ids.size(); i++) {
+        if (m_ids[i] < 0 || m_ids[i] >= NBR_IDS) {
+            cout << "Error: motor ID " << m_ids[i] << " is out of range!" << endl;
+            exit(1);
+        }
+        m_slot_from_id[m_ids[i]] = i;
+    }
+
+    checkMotorCompatibility();
+    if (m_isIndirectHandler)
+        setIndirectAddresses();
+
+    for (int i=0; i<m_handled_fields.size(); i++)
+        m_handled_fields[i].plan = buildFieldPlan(m_handled_fields[i].field);
+}
+
+/**
+ * @brief       Get the address of a field, checking that all handled motors store it at the same address
+ * @param[in]   field Query control field
+ * @retval      Address of the field in the handled motors' control tables
+ */
+uint16_t Handler::getFieldAddress(Fields field)
+{
+    uint16_t address = m_hal->getControlParametersFromID(m_ids[0], field).address;
+
+    for (int i=1; i<m_ids.size(); i++) {
+        if (m_hal->getControlParametersFromID(m_ids[i], field).address != address) {
+            cout << "Motors " << m_ids[i] << " and " << m_ids[0] << " have incompatible addresses!" << endl;
+            exit(1);
+        }
+    }
+
+    return address;
+}
+
+/**
+ * @brief       Get the byte length of a field, checking that it is the same for all handled motors
+ *              and that the field exists in their control tables
+ * @param[in]   field Query control field
+ * @retval      Byte length of the field
+ */
+uint8_t Handler::getFieldLength(Fields field)
+{
+    uint8_t length = m_hal->getControlParametersFromID(m_ids[0], field).length;
+
+    for (int i=1; i<m_ids.size(); i++) {
+        if (m_hal->getControlParametersFromID(m_ids[i], field).length != length) {
+            cout << "Motors " << m_ids[i] << " and " << m_ids[0] << " have incompatible field lengths!" << endl;
+            exit(1);
+        }
+    }
+
+    if (length == 0) {
+        cout << "Error: field " << field << " is not in the control table of the handled motors!" << endl;
+        exit(1);
+    }
+
+    return length;
+}
+
+/**
+ * @brief       Check if the motors are compatible for the handled fields (same addresses and lengths),
+ *              and locate the fields in the data read/written for each motor. \n
+ *              Fields following each other in the control table are accessed directly,
+ *              other ones through indirect addresses
+ * @retval      void
+ */
+void Handler::checkMotorCompatibility()
+{
+    Handled_field handled_field;
+
+    m_handled_fields.clear();
+    m_data_byte_size = 0;
+    m_isIndirectHandler = false;
+
+    for (int i=0; i<m_fields.size(); i++) {
+        handled_field.field = m_fields[i];
+        handled_field.address = getFieldAddress(m_fields[i]);
+        handled_field.length = getFieldLength(m_fields[i]);
+        handled_field.offset = m_data_byte_size;
+
+        if (i > 0 && handled_field.address != m_data_address + m_data_byte_size)
+            m_isIndirectHandler = true;
+        if (i == 0)
+            m_data_address = handled_field.address;
+
+        m_data_byte_size += handled_field.length;
+        m_handled_fields.push_back(handled_field);
+    }
+}
+
+/**
+ * @brief       Map the handled fields to free indirect data registers of the handled motors,
+ *              at the same place in all of them. Each motor is written and acknowledged once
+ * @note        The handlers are to be created while the motors are disabled
+ * @retval      void
+ */
+void Handler::setIndirectAddresses()
+{
+    int offset = m_hal->reserveIndirectData(m_ids, m_data_byte_size);
+    Motor_data_field indir_address = m_hal->getControlParametersFromID(m_ids[0], INDIR_ADDRESS_1);
+    Motor_data_field indir_data = m_hal->getControlParametersFromID(m_ids[0], INDIR_DATA_1);
+    vector<uint8_t> addresses(2 * m_data_byte_size);
+    uint8_t dxl_error = 0;
+    int dxl_comm_result;
+
+    // Address of each mapped byte, little endian
+    for (int i=0; i<m_handled_fields.size(); i++) {
+        const Handled_field& handled_field = m_handled_fields[i];
+        for (int k=0; k<handled_field.length; k++) {
+            addresses[2*(handled_field.offset + k)] = DXL_LOBYTE(handled_field.address + k);
+            addresses[2*(handled_field.offset + k) + 1] = DXL_HIBYTE(handled_field.address + k);
+        }
+    }
+
+    for (int i=0; i<m_ids.size(); i++) {
+        dxl_comm_result = packetHandler_->writeTxRx(portHandler_, m_ids[i], indir_address.address + 2*offset,
+                                                    addresses.size(), addresses.data(), &dxl_error);
+        if (dxl_comm_result != COMM_SUCCESS || dxl_error != 0) {
+            cout << "Failed to set the indirect addresses of motor " << m_ids[i] << "!" << endl;
+            if (dxl_comm_result != COMM_SUCCESS)
+                cout << packetHandler_->getTxRxResult(dxl_comm_result) << endl;
+            else
+                cout << packetHandler_->getRxPacketError(dxl_error) << endl;
+            exit(1);
+        }
+    }
+
+    m_data_address = indir_data.address + offset;
+}
+
+/**
+ * @brief       Resolve the info of each handled motor for a given field
+ * @param[in]   field Query control field
+ * @retval      Resolved info of each handled motor, same order as m_ids
+ */
+vector<Motor_plan> Handler::buildFieldPlan(Fields field)
+{
+    vector<Motor_plan> field_plan(m_ids.size());
+    Motor_plan plan = {};
+    Motor_models model;
+    int id;
+
+    for (int i=0; i<m_ids.size(); i++) {
+        id = m_ids[i];
+
+        plan.hal_idx = m_hal->getMotorsListIndexFromID(id);
+        model = m_hal->m_motor_models[plan.hal_idx];
+        plan.unit = m_hal->getControlParametersFromID(id, field).unit;
+        plan.multiturn = m_hal->m_multiturn[plan.hal_idx];
+        plan.codec = FIELD_INFOS[field].codec;
+
+        const Position_codec& position_codec = m_hal->positionCodec(model);
+        if (plan.codec == ANGLE_CODEC && position_codec.resolution <= 0) {
+            cout << "Motor " << id << ": model " << MOTOR_MODEL_NAMES[model]
+                 << " has no position codec, cannot convert between positions and angles!" << endl;
+            exit(1);
+        }
+
+        plan.center = position_codec.center;
+        plan.min_position = position_codec.min_position;
+        plan.max_position = position_codec.max_position;
+        // Reset only when a turn away from the ends of the multiturn range
+        plan.reset_min = position_codec.multiturn_min + position_codec.resolution;
+        plan.reset_max = position_codec.multiturn_max - position_codec.resolution;
+
+        field_plan[i] = plan;
+    }
+
+    return field_plan;
+}
+
+
+/*
+ *****************************************************************************
+ *                        Security checking functions
+ ****************************************************************************/
+
+/**
+ * @brief       Check if query motors are handled by this specific handler
+ * @param[in]   ids List of query motors
+ * @retval      void
+ */
+void Handler::checkIDvalidity(std::span<const int> ids)
+{
+    for (int i=0; i<ids.size(); i++) {
+        if (ids[i] < 0 || ids[i] >= NBR_IDS || m_slot_from_id[ids[i]] == -1) {
+            cout << "Error: motor " << ids[i] << " is not handled by this handler!" << endl;
+            exit(1);
+        }
+    }
+}
+
+/**
+ * @brief       Check if query field is handled by this specific handler
+ * @param[in]   field Query control field
+ * @retval      void
+ */
+void Handler::checkFieldValidity(Fields field)
+{
+    if (std::find(m_fields.begin(), m_fields.end(), field) == m_fields.end()) {
+        cout << "Error: field " << field << " is not handled by this handler!" << endl;
+        exit(1);
+    }
+}
+
+/**
+ * @brief       Get the index of a field in the list of handled fields
+ * @param[in]   field Query control field, handled by this handler
+ * @retval      Index of the field in the list of handled fields
+ */
+int Handler::getFieldIndex(Fields field)
+{
+    checkFieldValidity(field);
+    return std::find(m_fields.begin(), m_fields.end(), field) - m_fields.begin();
+}
+
+/**
+ * @brief       Get the index of a motor in the list of handled motors
+ * @param[in]   id Query motor
+ * @retval      Index of the motor in the list of handled motors
+ */
+int Handler::getMotorIndexFromID(int id)
+{
+    return m_slot_from_id[id];
+}
+
+}
@@ -0,0 +1,299 @@
+/**
+ ******************************************************************************
+ * @file            KMR_dxlP2_reader.cpp
+ * @brief           Defines the Reader class
+ ******************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ ******************************************************************************
+ */
+
+#include "KMR_dxlP2_reader.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+using std::cout;
+using std::endl;
+using std::vector;
+
+
+namespace KMR::dxlP2
+{
+
+/**
+ * @brief       Constructor for a Reader handler
+ * @param[in]   field Field to be handled by the reader
+ * @param[in]   ids Motors to be handled by the reader
+ * @param[in]   portHandler Object handling port communication
+ * @param[in]   packetHandler Object handling packets
+ * @param[in]   hal Previously initialized Hal object, shared by all handlers
+ */
+Reader::Reader(Fields field, vector<int> ids, dynamixel::PortHandler *portHandler,
+                            dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal)
+: Reader(vector<Fields>{field}, ids, portHandler, packetHandler, hal)
+{
+}
+
+/**
+ * @brief       Constructor for a Reader handler of several fields
+ * @note        Fields that do not follow each other in the control table are mapped to the motors'
+ *              indirect addresses: the reader is then to be created while the motors are disabled
+ * @param[in]   list_fields List of fields to be handled by the reader
+ * @param[in]   ids Motors to be handled by the reader
+ * @param[in]   portHandler Object handling port communication
+ * @param[in]   packetHandler Object handling packets
+ * @param[in]   hal Previously initialized Hal object, shared by all handlers
+ */
+Reader::Reader(vector<Fields> list_fields, vector<int> ids, dynamixel::PortHandler *portHandler,
+                            dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal)
+{
+    if (list_fields.empty()) {
+        cout << "[KMR::dxlP2::Reader] At least one field needs to be handled!" << endl;
+        exit(1);
+    }
+    for (int i=0; i<list_fields.size(); i++) {
+        if (std::find(list_fields.begin(), list_fields.begin()+i, list_fields[i]) != list_fields.begin()+i) {
+            cout << "[KMR::dxlP2::Reader] Field " << list_fields[i] << " is handled twice!" << endl;
+            exit(1);
+        }
+    }
+
+    initHandler(list_fields, ids, portHandler, packetHandler, hal);
+
+    m_groupSyncReader = new dynamixel::GroupSyncRead(portHandler_, packetHandler_, m_data_address, m_data_byte_size);
+
+    // Create the tables to save read data
+    m_received = new uint8_t[m_ids.size()]();
+    m_rawPerField = new int32_t[m_fields.size() * m_ids.size()]();
+    m_decoded = new uint8_t[m_fields.size()]();
+    m_dataPerField = new float* [m_fields.size()];
+    for (int i=0; i<m_fields.size(); i++)
+        m_dataPerField[i] = new float [m_ids.size()]();
+    m_dataFromMotor = m_dataPerField[0];
+}
+
+/**
+ * @brief Destructor
+ */
+Reader::~Reader()
+{
+    delete m_groupSyncReader;
+    delete m_groupFastSyncReader;
+
+    for (int i=0; i<m_fields.size(); i++)
+        delete[] m_dataPerField[i];
+    delete[] m_dataPerField;
+    delete[] m_received;
+    delete[] m_rawPerField;
+    delete[] m_decoded;
+}
+
+
+/*
+ *****************************************************************************
+ *                             Data reading
+ ****************************************************************************/
+
+/**
+ * @brief   Clear the parameters list: no motors added
+ */
+void Reader::clearParam()
+{
+    m_groupSyncReader->clearParam();
+    if (m_groupFastSyncReader != nullptr)
+        m_groupFastSyncReader->clearParam();
+}
+
+/**
+ * @brief       Read the motors with fast sync read instructions: all motors reply in a single
+ *              status packet, instead of one packet per motor
+ * @note        Needs motors with fast sync read support (MX firmware 2.0 v45 and above)
+ * @param[in]   enable True to use fast sync read, false to go back to sync read
+ * @retval      void
+ */
+void Reader::enableFastSyncRead(bool enable)
+{
+    if (enable && m_groupFastSyncReader == nullptr)
+        m_groupFastSyncReader = new dynamixel::GroupFastSyncRead(portHandler_, packetHandler_,
+                                                                 m_data_address, m_data_byte_size);
+    m_fastSyncRead = enable;
+}
+
+/**
+ * @brief       Read the handled fields of input motors
+ * @param[in]   ids List of motors whose fields will be read
+ * @retval      void
+ */
+void Reader::syncRead(std::span<const int> ids)
+{
+    int dxl_comm_result = COMM_TX_FAIL;             // Communication result
+
+    checkIDvalidity(ids);
+
+    if (m_fastSyncRead)
+        dxl_comm_result = sendReadRequest(m_groupFastSyncReader, ids);
+    else
+        dxl_comm_result = sendReadRequest(m_groupSyncReader, ids);
+
+    if (dxl_comm_result != COMM_SUCCESS)
+        cout << packetHandler_->getTxRxResult(dxl_comm_result) << endl;
+
+    checkReadSuccessful(ids);
+    populateOutputMatrix(ids);
+}
+
+/**
+ * @brief       Check which motors replied to the last read
+ * @param[in]   ids List of motors whose fields have just been read
+ * @retval      void
+ */
+void Reader::checkReadSuccessful(std::span<const int> ids)
+{
+    bool dxl_getdata_result = false;
+    int idx;
+
+    std::memset(m_received, 0, m_ids.size());
+
+    for (int i=0; i<ids.size(); i++) {
+        if (m_fastSyncRead)
+            dxl_getdata_result = m_groupFastSyncReader->isAvailable(ids[i], m_data_address, m_data_byte_size);
+        else
+            dxl_getdata_result = m_groupSyncReader->isAvailable(ids[i], m_data_address, m_data_byte_size);
+
+        idx = getMotorIndexFromID(ids[i]);
+        m_received[idx] = dxl_getdata_result;
+
+        if (dxl_getdata_result != true)
+            fprintf(stderr, "[ID:%03d] groupSyncRead getdata failed \n", ids[i]);
+    }
+}
+
+/**
+ * @brief       Get the raw value of a field from the last reply of a motor
+ * @param[in]   id ID of the motor, which replied to the last read
+ * @param[in]   handled_field Query handled field
+ * @retval      Raw value
+ */
+uint32_t Reader::getData(int id, const Handled_field& handled_field)
+{
+    int address = m_data_address + handled_field.offset;
+
+    if (m_fastSyncRead)
+        return m_groupFastSyncReader->getData(id, address, handled_field.length);
+    else
+        return m_groupSyncReader->getData(id, address, handled_field.length);
+}
+
+/**
+ * @brief       Save the read data into the output matrix: the parametrized values of all
+ *              fields, and the first field converted to SI units
+ * @note        Motors that did not reply keep their last valid values
+ * @param[in]   ids List of motors whose fields have been read
+ * @retval      void
+ */
+void Reader::populateOutputMatrix(std::span<const int> ids)
+{
+    int nbr_motors = m_ids.size();
+    uint32_t paramData;
+    int idx;
+
+    for (int f=0; f<m_handled_fields.size(); f++) {
+        const Handled_field& handled_field = m_handled_fields[f];
+        const Field_info& info = FIELD_INFOS[handled_field.field];
+
+        for (int i=0; i<ids.size(); i++) {
+            idx = getMotorIndexFromID(ids[i]);
+            if (!m_received[idx])
+                continue;
+
+            paramData = getData(ids[i], handled_field);
+
+            // Two's complement values
+            if (info.is_signed && handled_field.length == 2)
+                m_rawPerField[f*nbr_motors + idx] = (int16_t) paramData;
+            else
+                m_rawPerField[f*nbr_motors + idx] = (int32_t) paramData;
+        }
+    }
+
+    std::memset(m_decoded, 0, m_fields.size());
+    decodeField(0);
+}
+
+/**
+ * @brief       Convert a field's parametrized values of the last read into SI units
+ * @param[in]   field_idx Index of the field in the list of handled fields
+ * @retval      void
+ */
+void Reader::decodeField(int field_idx)
+{
+    const Handled_field& handled_field = m_handled_fields[field_idx];
+    const int32_t *params = m_rawPerField + field_idx*m_ids.size();
+    float *data = m_dataPerField[field_idx];
+
+    for (int i=0; i<m_ids.size(); i++) {
+        const Motor_plan& plan = handled_field.plan[i];
+
+        if (plan.codec == ANGLE_CODEC)
+            data[i] = (params[i] - plan.center) * plan.unit;
+        else
+            data[i] = params[i] * plan.unit;
+    }
+
+    m_decoded[field_idx] = 1;
+}
+
+
+/*
+ *****************************************************************************
+ *                             Data access
+ ****************************************************************************/
+
+/**
+ * @brief       Get the read values of a handled field, in SI units
+ * @param[in]   field Query field, handled by this reader
+ * @retval      Read values, same order as m_ids
+ */
+float* Reader::getFieldData(Fields field)
+{
+    int field_idx = getFieldIndex(field);
+
+    if (!m_decoded[field_idx])
+        decodeField(field_idx);
+
+    return m_dataPerField[field_idx];
+}
+
+/**
+ * @brief       Get the parametrized value of a handled field, as read from a motor
+ * @param[in]   field Query field, handled by this reader
+ * @param[in]   id Query motor, handled by this reader
+ * @retval      Parametrized value
+ */
+int32_t Reader::getRawValue(Fields field, int id)
+{
+    int ids[] = {id};
+    checkIDvalidity(ids);
+
+    return m_rawPerField[getFieldIndex(field)*m_ids.size() + getMotorIndexFromID(id)];
+}
+
+/**
+ * @brief       Check if a motor replied to the last read
+ * @param[in]   id Query motor, handled by this reader
+ * @retval      True if the motor's values come from the last read
+ */
+bool Reader::isValid(int id)
+{
+    int ids[] = {id};
+    checkIDvalidity(ids);
+
+    return m_received[getMotorIndexFromID(id)];
+}
+
+}
@@ -0,0 +1,260 @@
+/**
+ ******************************************************************************
+ * @file            KMR_dxlP2_robot.cpp
+ * @brief           Defines the BaseRobot class
+ ******************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+
+#include <unistd.h>  // Provides sleep function for linux
+#include "KMR_dxlP2_robot.hpp"
+
+#define PROTOCOL_VERSION            2.0
+#define ENABLE                      1
+#define DISABLE                     0
+#define EEPROM_WRITE_US             10000   // Time for the motors to store EEPROM writes
+
+static const int ENABLE_DATA[] = {ENABLE};
+static const int DISABLE_DATA[] = {DISABLE};
+
+
+using namespace std;
+
+namespace KMR::dxlP2
+{
+
+
+/**
+ * @brief       Constructor for BaseRobot
+ * @param[in]   all_ids List of IDs of all the motors in the robot
+ * @param[in]   port_name Name of the port handling the communication with motors
+ * @param[in]   baudrate Baudrate of the port handling communication with motors
+ * @param[in]   hal Previously initialized Hal object, shared by all handlers
+ */
+BaseRobot::BaseRobot(vector<int> all_ids, const char *port_name, int baudrate, std::shared_ptr<Hal> hal)
+{
+    m_hal = hal;
+    m_all_IDs = all_ids;
+
+    // Connect U2D2
+    init_comm(port_name, baudrate, PROTOCOL_VERSION);
+
+    // Ping each motor to validate the communication is working
+    check_comm();
+
+    // 2 integrated handlers: motor enabling and mode setter
+    m_motor_enabler = new Writer(TRQ_ENABLE, m_all_IDs, portHandler_, packetHandler_, m_hal);
+    m_mode_writer = new Writer(OPERATING_MODE, m_all_IDs, portHandler_, packetHandler_, m_hal);
+
+    // Position or extended position mode, as declared in the config file
+    vector<int> joint_ids, multiturn_ids;
+    for (int i=0; i<m_all_IDs.size(); i++) {
+        if (m_hal->m_multiturn[m_hal->getMotorsListIndexFromID(m_all_IDs[i])])
+            multiturn_ids.push_back(m_all_IDs[i]);
+        else
+            joint_ids.push_back(m_all_IDs[i]);
+    }
+
+    disableMotors();
+    setOperatingModes(joint_ids, false);
+    setOperatingModes(multiturn_ids, true);
+}
+
+
+/**
+ * @brief Destructor
+ */
+BaseRobot::~BaseRobot()
+{
+    delete m_motor_enabler;
+    delete m_mode_writer;
+}
+
+
+/**
+ * @brief       Initialize the serial communication
+ * @param[in]   port_name Name of the port handling communication with motors
+ * @param[in]   baudrate Baudrate of the port handling communication with motors
+ * @param[in]   protocol_version Protocol version, for the communication (U2D2)
+ * @retval      void
+ */
+void BaseRobot::init_comm(const char *port_name, int baudrate, float protocol_version)
+{
+    portHandler_ = dynamixel::PortHandler::getPortHandler(port_name);
+    if (!portHandler_->openPort()) {
+        cout<< "Failed to open the motors port!" <<endl;
+        exit(1);
+    }
+    else
+        cout<< "Succeed to open the motors port" <<endl;
+
+    if (!portHandler_->setBaudRate(baudrate)) {
+        cout<< "Failed to set baudrate!" <<endl;
+        return ;
+    }
+    else
+        cout<< "Succeeded to change the baudrate!" <<endl;
+
+    packetHandler_ = dynamixel::PacketHandler::getPacketHandler(protocol_version);
+}
+
+/**
+ * @brief       Ping each motor to validate the communication is working, and check
+ *              that its model is the one declared in the config file
+ * @retval      void
+ */
+void BaseRobot::check_comm()
+{
+    int result = COMM_TX_FAIL;
+    uint16_t model_number = 0;
+    uint8_t dxl_error = 0;
+    int id = 0;
+
+    cout << "Pinging motors...." << endl;
+
+    for (int i=0; i<m_all_IDs.size(); i++) {
+        id = m_all_IDs[i];
+        result = packetHandler_->ping(portHandler_, id, &model_number, &dxl_error);
+        if (result != COMM_SUCCESS) {
+            cout << "Failed to ping, check config file and motor ID: " << id << endl;
+            cout << packetHandler_->getTxRxResult(result) << endl;
+            exit(1);
+        }
+        else {
+            cout << "id: " << id << ", model number : " << model_number << endl;
+            m_hal->updateScannedModel(id, model_number);
+
+            if (modelFromModelNumber(model_number) != m_hal->getMotorFromID(id).model) {
+                cout << "Motor " << id << " is not a " << MOTOR_MODEL_NAMES[m_hal->getMotorFromID(id).model]
+                     << " as declared in the config file!" << endl;
+                exit(1);
+            }
+        }
+    }
+}
+
+/**
+ * @brief       Set disabled motors to position mode or extended position (multiturn) mode
+ * @param[in]   ids List of motors whose operating mode is set
+ * @param[in]   multiturn True for extended position mode, false for position mode
+ * @retval      void
+ */
+void BaseRobot::setOperatingModes(std::span<const int> ids, bool multiturn)
+{
+    vector<int> modes(ids.size());
+    Control_modes control_modes;
+
+    if (ids.empty())
+        return;
+
+    for (int i=0; i<ids.size(); i++) {
+        control_modes = m_hal->getMotorFromID(ids[i]).control_modes;
+        modes[i] = multiturn ? control_modes.multiturn_control : control_modes.position_control;
+    }
+
+    m_mode_writer->addDataToWrite(std::span<const int>(modes), OPERATING_MODE, ids);
+    m_mode_writer->syncWrite(ids);
+    usleep(EEPROM_WRITE_US);
+}
+
+
+/*
+ *****************************************************************************
+ *                         Enabling/disabling motors
+ ****************************************************************************/
+
+/**
+ * @brief       Enable all the motors
+ * @retval      void
+ */
+void BaseRobot::enableMotors()
+{
+    enableMotors(m_all_IDs);
+}
+
+/**
+ * @brief       Enable motors specified by IDs
+ * @param[in]   ids List of motor ids to be enabled
+ * @retval      void
+ */
+void BaseRobot::enableMotors(std::span<const int> ids)
+{
+    m_motor_enabler->addDataToWrite(std::span<const int>(ENABLE_DATA), TRQ_ENABLE, ids);
+    m_motor_enabler->syncWrite(ids);
+}
+
+/**
+ * @brief       Disable all the motors
+ * @retval      void
+ */
+void BaseRobot::disableMotors()
+{
+    disableMotors(m_all_IDs);
+}
+
+/**
+ * @brief       Disable motors specified by IDs
+ * @param[in]   ids List of motor ids to be disabled
+ * @retval      void
+ */
+void BaseRobot::disableMotors(std::span<const int> ids)
+{
+    m_motor_enabler->addDataToWrite(std::span<const int>(DISABLE_DATA), TRQ_ENABLE, ids);
+    m_motor_enabler->syncWrite(ids);
+}
+
+
+/*
+ *****************************************************************************
+ *                         Multiturn reset
+ ****************************************************************************/
+
+/**
+ * @brief       Reset the multiturn motors flagged by the writers, ie whose goal positions came
+ *              close to the ends of the extended position range. \n
+ *              Switching them to position mode brings their present positions back within one turn,
+ *              they are then switched back to extended position mode
+ * @note        Blocking: the reset motors are disabled during the reset
+ * @param[in]   sleep_time_us Waiting time between the steps of the reset [us]
+ * @retval      void
+ */
+void BaseRobot::resetMultiturnMotors(int sleep_time_us)
+{
+    vector<int> reset_ids;
+
+    for (int i=0; i<m_all_IDs.size(); i++) {
+        if (m_hal->resetStatusAt(m_hal->getMotorsListIndexFromID(m_all_IDs[i])))
+            reset_ids.push_back(m_all_IDs[i]);
+    }
+
+    if (reset_ids.empty())
+        return;
+
+    disableMotors(reset_ids);
+    setOperatingModes(reset_ids, false);
+
+    // The present positions are brought back within one turn when the torque is enabled
+    enableMotors(reset_ids);
+    usleep(sleep_time_us);
+    disableMotors(reset_ids);
+
+    setOperatingModes(reset_ids, true);
+    enableMotors(reset_ids);
+    usleep(sleep_time_us);
+
+    for (int i=0; i<reset_ids.size(); i++)
+        m_hal->updateResetStatus(reset_ids[i], 0);
+}
+
+}
@@ -0,0 +1,231 @@
+/**
+ ******************************************************************************
+ * @file            KMR_dxlP2_writer.cpp
+ * @brief           Defines the Writer class
+ ******************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ ******************************************************************************
+ */
+
+#include "KMR_dxlP2_writer.hpp"
+#include <algorithm>
+#include <cstdint>
+
+using std::cout;
+using std::endl;
+using std::vector;
+
+
+namespace KMR::dxlP2
+{
+
+/**
+ * @brief       Constructor for a Writer handler
+ * @param[in]   field Field to be handled by the writer
+ * @param[in]   ids Motors to be handled by the writer
+ * @param[in]   portHandler Object handling port communication
+ * @param[in]   packetHandler Object handling packets
+ * @param[in]   hal Previously initialized Hal object, shared by all handlers
+ */
+Writer::Writer(Fields field, vector<int> ids, dynamixel::PortHandler *portHandler,
+                            dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal)
+: Writer(vector<Fields>{field}, ids, portHandler, packetHandler, hal)
+{
+}
+
+/**
+ * @brief       Constructor for a Writer handler of several fields
+ * @note        Fields that do not follow each other in the control table are mapped to the motors'
+ *              indirect addresses: the writer is then to be created while the motors are disabled
+ * @param[in]   list_fields List of fields to be handled by the writer
+ * @param[in]   ids Motors to be handled by the writer
+ * @param[in]   portHandler Object handling port communication
+ * @param[in]   packetHandler Object handling packets
+ * @param[in]   hal Previously initialized Hal object, shared by all handlers
+ */
+Writer::Writer(vector<Fields> list_fields, vector<int> ids, dynamixel::PortHandler *portHandler,
+                            dynamixel::PacketHandler *packetHandler, std::shared_ptr<Hal> hal)
+{
+    if (list_fields.empty()) {
+        cout << "[KMR::dxlP2::Writer] At least one field needs to be handled!" << endl;
+        exit(1);
+    }
+    for (int i=0; i<list_fields.size(); i++) {
+        if (std::find(list_fields.begin(), list_fields.begin()+i, list_fields[i]) != list_fields.begin()+i) {
+            cout << "[KMR::dxlP2::Writer] Field " << list_fields[i] << " is handled twice!" << endl;
+            exit(1);
+        }
+    }
+
+    initHandler(list_fields, ids, portHandler, packetHandler, hal);
+
+    m_groupSyncWriter = new dynamixel::GroupSyncWrite(portHandler_, packetHandler_, m_data_address, m_data_byte_size);
+
+    // Create the table to save parametrized data (to be sent to motors)
+    m_dataParam = new uint8_t* [m_ids.size()];
+    for (int i=0; i<m_ids.size(); i++)
+        m_dataParam[i] = new uint8_t [m_data_byte_size]();
+}
+
+/**
+ * @brief Destructor
+ */
+Writer::~Writer()
+{
+    delete m_groupSyncWriter;
+
+    for (int i=0; i<m_ids.size(); i++)
+        delete[] m_dataParam[i];
+    delete[] m_dataParam;
+}
+
+
+/*
+ *****************************************************************************
+ *                         Preparing for writing
+ ****************************************************************************/
+
+/**
+ * @brief       Limit the position of a motor to its range
+ * @note        Multiturn motors are flagged for a reset (BaseRobot::resetMultiturnMotors)
+ *              once they come close to the ends of the extended position range
+ * @param[in]   position Parametrized goal position
+ * @param[in]   plan Resolved info of the motor
+ * @retval      Limited position
+ */
+int Writer::limitPosition(int position, const Motor_plan& plan)
+{
+    if (!plan.multiturn)
+        bindParameter(plan.min_position, plan.max_position, position);
+
+    else if (multiturnOverLimit(position, plan))
+        m_hal->updateResetStatusAt(plan.hal_idx, 1);
+
+    return position;
+}
+
+/**
+ * @brief           Saturate input value between input limits
+ * @param[in]       lower_bound Min. value the input can take
+ * @param[in]       upper_bound Max. value the input can take
+ * @param[in/out]   param Input value to be saturated
+ * @return          void
+ */
+void Writer::bindParameter(int lower_bound, int upper_bound, int& param)
+{
+    if (param > upper_bound)
+        param = upper_bound;
+
+    else if (param < lower_bound)
+        param = lower_bound;
+}
+
+/**
+ * @brief       Save a parametrized data into the general table
+ * @param[in]   data Parametrized data to be sent to motor
+ * @param[in]   motor_idx Index of the motor
+ * @param[in]   field_offset Position of the field in the bytes sent to the motor
+ * @param[in]   field_length Byte size of the data
+ * @retval      void
+ */
+void Writer::populateDataParam(int32_t data, int motor_idx, int field_offset, int field_length)
+{
+    uint8_t *param = m_dataParam[motor_idx] + field_offset;
+
+    if (field_length == 4) {
+        param[0] = DXL_LOBYTE(DXL_LOWORD(data));
+        param[1] = DXL_HIBYTE(DXL_LOWORD(data));
+        param[2] = DXL_LOBYTE(DXL_HIWORD(data));
+        param[3] = DXL_HIBYTE(DXL_HIWORD(data));
+    }
+    else if (field_length == 2) {
+        param[0] = DXL_LOBYTE(data);
+        param[1] = DXL_HIBYTE(data);
+    }
+    else
+        param[0] = (uint8_t) data;
+}
+
+/**
+ * @brief       Check if a multiturn position is close to the ends of the extended position range
+ * @param[in]   position Parametrized position
+ * @param[in]   plan Resolved info of the motor
+ * @retval      True if the motor needs a reset
+ */
+bool Writer::multiturnOverLimit(int position, const Motor_plan& plan)
+{
+    if (position > plan.reset_max || position < plan.reset_min)
+        return true;
+    else
+        return false;
+}
+
+
+/*
+ *****************************************************************************
+ *                             Data writing
+ ****************************************************************************/
+
+/**
+ * @brief   Clear the parameters list: no motors added
+ */
+void Writer::clearParam()
+{
+    m_groupSyncWriter->clearParam();
+}
+
+/**
+ * @brief       Add a motor to the list of motors who will receive data
+ * @param[in]   id ID of the motor
+ * @param[in]   data Parametrized data to be sent to the motor
+ * @retval      bool: true if motor added successfully
+ */
+bool Writer::addParam(uint8_t id, uint8_t* data)
+{
+    bool dxl_addparam_result = m_groupSyncWriter->addParam(id, data);
+    return dxl_addparam_result;
+}
+
+/**
+ * @brief       Send the data to all handled motors
+ * @retval      void
+ */
+void Writer::syncWrite()
+{
+    syncWrite(m_ids);
+}
+
+/**
+ * @brief       Send the data to input motors
+ * @param[in]   ids List of motors that will receive their data
+ * @retval      void
+ */
+void Writer::syncWrite(std::span<const int> ids)
+{
+    int dxl_comm_result = COMM_TX_FAIL;
+    bool dxl_addparam_result = false;
+
+    checkIDvalidity(ids);
+    clearParam();
+
+    for (int i=0; i<ids.size(); i++) {
+        dxl_addparam_result = addParam((uint8_t)ids[i], m_dataParam[getMotorIndexFromID(ids[i])]);
+        if (dxl_addparam_result != true) {
+            cout << "[KMR::dxlP2::Writer] Adding parameters failed for ID = " << ids[i] << endl;
+            exit(1);
+        }
+    }
+
+    dxl_comm_result = m_groupSyncWriter->txPacket();
+    if (dxl_comm_result != COMM_SUCCESS)
+        cout << packetHandler_->getTxRxResult(dxl_comm_result) << endl;
+
+    clearParam();
+}
+
+}
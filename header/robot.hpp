@@ -20,21 +20,29 @@
 
 class Robot : public KMR::dxlP1::BaseRobot {
 private:
-    KMR::dxlP1::Writer *m_writer;
-    KMR::dxlP1::Writer *m_led_writer;
-    KMR::dxlP1::Reader *m_reader;
+    KMR::dxlP1::FieldWriter<KMR::dxlP1::GOAL_POS> *m_writer;
+    KMR::dxlP1::FieldWriter<KMR::dxlP1::LED> *m_led_writer;
+    KMR::dxlP1::Writer *m_speed_limited_writer;
+    KMR::dxlP1::FieldReader<KMR::dxlP1::PRESENT_POS> *m_reader;
     KMR::dxlP1::Reader *m_enabled_reader;
     KMR::dxlP1::Reader *m_led_reader;
+    KMR::dxlP1::Reader *m_feedback_reader;
 
     KMR::dxlP1::Reader *m_CW_reader;
 
 public:
-    Robot(std::vector<int> all_ids, const char *port_name, int baudrate, KMR::dxlP1::Hal hal);
-    void writeData(std::vector<float> angles, std::vector<int> ids);
-    void readData(std::vector<int> ids, std::vector<float>& fbck_angles);
+    Robot(std::vector<int> all_ids, const char *port_name, int baudrate, std::shared_ptr<KMR::dxlP1::Hal> hal);
+    void writeData(std::span<const float> angles, std::span<const int> ids);
+    void writeData(std::span<const float> angles, std::span<const float> speeds, std::span<const int> ids);
+    void readData(std::span<const int> ids, std::vector<float>& fbck_angles);
+    void writeReadData(std::span<const float> angles, std::vector<float>& fbck_angles);
+    void beginReadData();
+    bool collectReadData(std::vector<float>& fbck_angles);
     void writeLEDs(std::vector<int> goal_leds, std::vector<int> ids);
     void readEnabled(std::vector<int> ids, std::vector<float>& fbck_enabled);
     void readLEDs(std::vector<int> ids, std::vector<float>& fbck_leds);
+    void readFeedback(std::vector<int> ids, std::vector<float>& fbck_angles, std::vector<float>& fbck_speeds,
+                      std::vector<float>& fbck_loads, std::vector<float>& fbck_temps);
 
     void checkMode(std::vector<int> ids);
 };
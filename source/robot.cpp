@@ -26,28 +26,51 @@ using namespace std;
  * @param[in]   baudrate Baudrate of the port handling communication with motors
  * @param[in]   port_name Name of the port handling communication with motors
  */
-Robot::Robot(vector<int> all_ids, const char *port_name, int baudrate, KMR::dxlP1::Hal hal)
+Robot::Robot(vector<int> all_ids, const char *port_name, int baudrate, std::shared_ptr<KMR::dxlP1::Hal> hal)
 : BaseRobot(all_ids, port_name, baudrate, hal)
 {
     // Create handlers
-    m_writer = new KMR::dxlP1::Writer(KMR::dxlP1::GOAL_POS, all_ids, portHandler_, packetHandler_, m_hal);
-    m_led_writer = new KMR::dxlP1::Writer(KMR::dxlP1::LED, all_ids, portHandler_, packetHandler_, m_hal);
-    m_reader = new KMR::dxlP1::Reader(KMR::dxlP1::PRESENT_POS, all_ids, portHandler_, packetHandler_, m_hal);
+    m_writer = new KMR::dxlP1::FieldWriter<KMR::dxlP1::GOAL_POS>(all_ids, portHandler_, packetHandler_, m_hal);
+    m_led_writer = new KMR::dxlP1::FieldWriter<KMR::dxlP1::LED>(all_ids, portHandler_, packetHandler_, m_hal);
+
+    // Idle legs are not sent: goals sent on change only, and to all motors every 100 writes
+    m_writer->setDeltaSuppression(0, 100);
+
+    // LEDs are sent on change only, with a broadcast write when all motors get the same state
+    m_led_writer->setDeltaSuppression(0, 0);
+    m_led_writer->enableBroadcast();
+
+    // Contiguous fields: sent with a single sync write
+    vector<KMR::dxlP1::Fields> speed_limited_fields = {KMR::dxlP1::GOAL_POS, KMR::dxlP1::MOVING_SPEED};
+    m_speed_limited_writer = new KMR::dxlP1::Writer(speed_limited_fields, all_ids, portHandler_, packetHandler_, m_hal);
+    m_reader = new KMR::dxlP1::FieldReader<KMR::dxlP1::PRESENT_POS>(all_ids, portHandler_, packetHandler_, m_hal);
     m_enabled_reader = new KMR::dxlP1::Reader(KMR::dxlP1::TRQ_ENABLE, all_ids, portHandler_, packetHandler_, m_hal);
     m_led_reader = new KMR::dxlP1::Reader(KMR::dxlP1::LED, all_ids, portHandler_, packetHandler_, m_hal);
 
+    // Contiguous fields: fetched with a single bulk read
+    vector<KMR::dxlP1::Fields> feedback_fields = {KMR::dxlP1::PRESENT_POS, KMR::dxlP1::PRESENT_SPEED, 
+                                                  KMR::dxlP1::PRESENT_LOAD, KMR::dxlP1::PRESENT_TEMP};
+    m_feedback_reader = new KMR::dxlP1::Reader(feedback_fields, all_ids, portHandler_, packetHandler_, m_hal);
+
     m_CW_reader = new KMR::dxlP1::Reader(KMR::dxlP1::CW_ANGLE_LIMIT, all_ids, portHandler_, packetHandler_, m_hal);
 
     cout << "Robot instance created" << endl;
 }
 
-void Robot::writeData(vector<float> angles, vector<int> ids)
+void Robot::writeData(span<const float> angles, span<const int> ids)
 {
     m_writer->addDataToWrite(angles, ids);
     m_writer->syncWrite(ids);
 }
 
-void Robot::readData(vector<int> ids, vector<float>& fbck_angles)
+void Robot::writeData(span<const float> angles, span<const float> speeds, span<const int> ids)
+{
+    m_speed_limited_writer->addDataToWrite(angles, KMR::dxlP1::GOAL_POS, ids);
+    m_speed_limited_writer->addDataToWrite(speeds, KMR::dxlP1::MOVING_SPEED, ids);
+    m_speed_limited_writer->syncWrite(ids);
+}
+
+void Robot::readData(span<const int> ids, vector<float>& fbck_angles)
 {
     m_reader->syncRead(ids);
 
@@ -64,6 +87,45 @@ void Robot::readData(vector<int> ids, vector<float>& fbck_angles)
 
 }
 
+/**
+ * @brief       Send goal angles to all motors and read their positions, in a single bus transfer
+ * @param[in]   angles Goal angles, same order as all_ids
+ * @param[out]  fbck_angles Read angles, same order as all_ids
+ */
+void Robot::writeReadData(span<const float> angles, vector<float>& fbck_angles)
+{
+    m_writer->addDataToWrite(angles, m_all_IDs);
+    m_batcher->addWrite(m_writer);
+    m_batcher->addRead(m_reader);
+    m_batcher->flush();
+
+    for (int i=0; i<m_all_IDs.size(); i++)
+        fbck_angles[i] = m_reader->m_dataFromMotor[i];
+}
+
+/**
+ * @brief       Start reading the positions of all motors, without waiting for their replies
+ */
+void Robot::beginReadData()
+{
+    m_reader->beginRead();
+}
+
+/**
+ * @brief       Save the positions of the read started with beginReadData
+ * @param[out]  fbck_angles Read angles, same order as all_ids
+ * @retval      bool: true if all motors replied
+ */
+bool Robot::collectReadData(vector<float>& fbck_angles)
+{
+    bool all_replied = m_reader->collect();
+
+    for (int i=0; i<m_all_IDs.size(); i++)
+        fbck_angles[i] = m_reader->m_dataFromMotor[i];
+
+    return all_replied;
+}
+
 void Robot::writeLEDs(vector<int> goal_leds, vector<int> ids)
 {
     m_led_writer->addDataToWrite(goal_leds, ids);
@@ -91,6 +153,24 @@ void Robot::readLEDs(vector<int> ids, vector<float>& fbck_leds)
 
 }
 
+void Robot::readFeedback(vector<int> ids, vector<float>& fbck_angles, vector<float>& fbck_speeds,
+                         vector<float>& fbck_loads, vector<float>& fbck_temps)
+{
+    m_feedback_reader->syncRead(ids);
+
+    float *angles = m_feedback_reader->getFieldData(KMR::dxlP1::PRESENT_POS);
+    float *speeds = m_feedback_reader->getFieldData(KMR::dxlP1::PRESENT_SPEED);
+    float *loads = m_feedback_reader->getFieldData(KMR::dxlP1::PRESENT_LOAD);
+    float *temps = m_feedback_reader->getFieldData(KMR::dxlP1::PRESENT_TEMP);
+
+    for (int i=0; i<ids.size(); i++) {
+        fbck_angles[i] = angles[i];
+        fbck_speeds[i] = speeds[i];
+        fbck_loads[i] = loads[i];
+        fbck_temps[i] = temps[i];
+    }
+}
+
 void Robot::checkMode(vector<int> ids)
 {
     double CW_limit;
@@ -0,0 +1,259 @@
+/**
+ ******************************************************************************
+ * @file            KMR_dxl_tablegen.cpp
+ * @brief           Build-time generator of the motor models' control tables, shared by the
+ *                  KMR_dxlP1 and KMR_dxlP2 libraries
+ ******************************************************************************
+ * @copyright
+ * Copyright 2021-2023 Laura Paez Coy and Kamilo Melo                    \n
+ * This code is under MIT licence: https://opensource.org/licenses/MIT
+ * @authors  Laura.Paez@KM-RoBota.com, 08/2023
+ * @authors  Kamilo.Melo@KM-RoBota.com, 08/2023
+ * @authors katarina.lichardova@km-robota.com, 08/2023
+ ******************************************************************************
+ * Usage: KMR_dxl_tablegen <namespace> <prefix> <output_dir> <model_1.yaml> [<model_2.yaml> ...]
+ *        eg. KMR_dxl_tablegen KMR::dxlP1 KMR_dxlP1 generated config/motor_models/MX_64R.yaml ...
+ *
+ * Parses every motor model file once, at build time, and writes two headers:
+ *  - <prefix>_motor_models.hpp: the Motor_models enumerate, the model names 
+ *    and the model number -> model conversion
+ *  - <prefix>_control_tables.hpp: constexpr control tables, control modes 
+ *    and position codecs, using the Hal types of <prefix>_hal.hpp
+ * Field names are emitted as Fields enumerators, so a typo in a yaml file
+ * is a compile error of the library instead of a silently ignored field.
+ ******************************************************************************
+ */
+
+#include "yaml-cpp/yaml.h"
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+/**
+ * @brief       Library the headers are generated for
+ */
+struct Target_library {
+    string name_space;      // Namespace of the library, eg "KMR::dxlP1"
+    string prefix;          // Prefix of the library's files, eg "KMR_dxlP1"
+    string guard_prefix;    // Prefix of the include guards, eg "KMR_DXLP1"
+};
+
+
+/**
+ * @brief       Info of a single motor model, as read from its yaml file
+ */
+struct Model_description {
+    string name;
+    vector<int> model_numbers;
+    YAML::Node operating_modes;
+    YAML::Node position_codec;
+    YAML::Node motor_data;
+};
+
+
+/**
+ * @brief       Check that a string can be used as a C++ identifier
+ * @param[in]   str Query string
+ * @retval      bool: true if valid identifier
+ */
+static bool isIdentifier(const string& str)
+{
+    if (str.empty() || isdigit((unsigned char)str[0]))
+        return false;
+
+    for (int i=0; i<str.size(); i++) {
+        if (!isalnum((unsigned char)str[i]) && str[i] != '_')
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief       Format a yaml scalar as a float literal
+ * @param[in]   value Value to be formatted
+ * @retval      Float literal, eg "0.001536f"
+ */
+static string floatLiteral(double value)
+{
+    ostringstream literal;
+    literal.precision(9);
+    literal << value;
+
+    string str = literal.str();
+    if (str.find_first_of(".e") == string::npos)
+        str += ".0";
+
+    return str + "f";
+}
+
+/**
+ * @brief       Write the header declaring the Motor_models enumerate
+ * @param[in]   path Path of the output header
+ * @param[in]   library Library the header is generated for
+ * @param[in]   models Description of all motor models
+ * @retval      void
+ */
+static void writeModelsHeader(const string& path, const Target_library& library, const vector<Model_description>& models)
+{
+    ofstream out(path);
+
+    out << "// Generated by KMR_dxl_tablegen from config/motor_models/*.yaml: do not edit\n\n";
+    out << "#ifndef " << library.guard_prefix << "_MOTOR_MODELS_HPP\n";
+    out << "#define " << library.guard_prefix << "_MOTOR_MODELS_HPP\n\n";
+    out << "namespace " << library.name_space << "\n{\n\n";
+
+    out << "/**\n";
+    out << " * @brief       Enumerate of all dynamixel motor models having a file in config/motor_models\n";
+    out << " */\n";
+    out << "enum Motor_models\n{\n    ";
+    for (int i=0; i<models.size(); i++)
+        out << models[i].name << ", ";
+    out << "NBR_MODELS, UNDEF_M\n};\n\n";
+
+    out << "/**\n";
+    out << " * @brief       Names of the motor models, indexed by Motor_models\n";
+    out << " */\n";
+    out << "inline constexpr const char* MOTOR_MODEL_NAMES[NBR_MODELS] = {\n";
+    for (int i=0; i<models.size(); i++)
+        out << "    \"" << models[i].name << "\",\n";
+    out << "};\n\n";
+
+    out << "/**\n";
+    out << " * @brief       Convert a Dynamixel-defined model number (as returned by a ping) to Motor_models\n";
+    out << " */\n";
+    out << "constexpr Motor_models modelFromModelNumber(int model_number)\n{\n";
+    out << "    switch (model_number) {\n";
+    for (int i=0; i<models.size(); i++) {
+        for (int j=0; j<models[i].model_numbers.size(); j++)
+            out << "        case " << models[i].model_numbers[j] << ": return " << models[i].name << ";\n";
+    }
+    out << "        default: return UNDEF_M;\n";
+    out << "    }\n}\n\n";
+
+    out << "}\n\n#endif\n";
+}
+
+/**
+ * @brief       Write the header defining the constexpr control tables of all models
+ * @param[in]   path Path of the output header
+ * @param[in]   library Library the header is generated for
+ * @param[in]   models Description of all motor models
+ * @retval      void
+ */
+static void writeTablesHeader(const string& path, const Target_library& library, const vector<Model_description>& models)
+{
+    ofstream out(path);
+
+    out << "// Generated by KMR_dxl_tablegen from config/motor_models/*.yaml: do not edit\n\n";
+    out << "#ifndef " << library.guard_prefix << "_CONTROL_TABLES_HPP\n";
+    out << "#define " << library.guard_prefix << "_CONTROL_TABLES_HPP\n\n";
+    out << "#include \"" << library.prefix << "_hal.hpp\"\n";
+    out << "#include <array>\n\n";
+    out << "namespace " << library.name_space << "\n{\n\n";
+
+    out << "using Control_table = std::array<std::array<Motor_data_field, NBR_FIELDS>, NBR_MODELS>;\n\n";
+
+    // Control tables
+    out << "/**\n";
+    out << " * @brief       Build the control tables of all models. Undeclared fields stay zeroed\n";
+    out << " */\n";
+    out << "constexpr Control_table makeControlTables()\n{\n";
+    out << "    Control_table table = {};\n";
+    for (int i=0; i<models.size(); i++) {
+        out << "\n    // " << models[i].name << "\n";
+        for (int j=0; j<models[i].motor_data.size(); j++) {
+            const YAML::Node& data = models[i].motor_data[j];
+            out << "    table[" << models[i].name << "][" << data["field"].as<string>() << "] = {"
+                << data["address"].as<int>() << ", "
+                << data["length"].as<int>() << ", "
+                << floatLiteral(data["unit"].as<double>()) << "};\n";
+        }
+    }
+    out << "\n    return table;\n}\n\n";
+    out << "inline constexpr Control_table CONTROL_TABLES = makeControlTables();\n\n";
+
+    // Control modes
+    out << "/**\n";
+    out << " * @brief       Control modes values of all models, indexed by Motor_models\n";
+    out << " */\n";
+    out << "inline constexpr Control_modes CONTROL_MODES[NBR_MODELS] = {\n";
+    for (int i=0; i<models.size(); i++) {
+        const YAML::Node& modes = models[i].operating_modes;
+        // Same member order as the Control_modes structure
+        out << "    {" << modes["current_control"].as<int>() << ", "
+            << modes["velocity_control"].as<int>() << ", "
+            << modes["position_control"].as<int>() << ", "
+            << modes["multiturn_control"].as<int>() << ", "
+            << modes["current_based_position_control"].as<int>() << ", "
+            << modes["PWM_control"].as<int>() << "},  // " << models[i].name << "\n";
+    }
+    out << "};\n\n";
+
+    // Position codecs
+    out << "/**\n";
+    out << " * @brief       Position codecs of all models, indexed by Motor_models\n";
+    out << " */\n";
+    out << "inline constexpr Position_codec POSITION_CODECS[NBR_MODELS] = {\n";
+    for (int i=0; i<models.size(); i++) {
+        const YAML::Node& codec = models[i].position_codec;
+        // Same member order as the Position_codec structure
+        out << "    {" << codec["resolution"].as<int>() << ", "
+            << codec["center"].as<int>() << ", "
+            << codec["min_position"].as<int>() << ", "
+            << codec["max_position"].as<int>() << ", "
+            << codec["multiturn_min"].as<int>() << ", "
+            << codec["multiturn_max"].as<int>() << "},  // " << models[i].name << "\n";
+    }
+    out << "};\n\n";
+
+    out << "}\n\n#endif\n";
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 5) {
+        cout << "Usage: KMR_dxl_tablegen <namespace> <prefix> <output_dir> <model_1.yaml> [<model_2.yaml> ...]" << endl;
+        return 1;
+    }
+
+    Target_library library;
+    library.name_space = argv[1];
+    library.prefix = argv[2];
+    library.guard_prefix = library.prefix;
+    for (int i=0; i<library.guard_prefix.size(); i++)
+        library.guard_prefix[i] = toupper((unsigned char)library.guard_prefix[i]);
+
+    string output_dir = argv[3];
+    vector<Model_description> models;
+
+    for (int i=4; i<argc; i++) {
+        YAML::Node config = YAML::LoadFile(argv[i]);
+        Model_description model;
+
+        model.name = config["model_name"].as<string>();
+        model.model_numbers = config["model_numbers"].as<vector<int>>();
+        model.operating_modes = config["operating_modes"][0];
+        model.position_codec = config["position_codec"][0];
+        model.motor_data = config["motor_data"];
+
+        if (!isIdentifier(model.name)) {
+            cout << "[KMR::dxl] Invalid model name \"" << model.name << "\" in " << argv[i]
+                 << ": use underscores, not hyphens" << endl;
+            return 1;
+        }
+
+        models.push_back(model);
+    }
+
+    writeModelsHeader(output_dir + "/" + library.prefix + "_motor_models.hpp", library, models);
+    writeTablesHeader(output_dir + "/" + library.prefix + "_control_tables.hpp", library, models);
+
+    return 0;
+}